@@ -29,19 +29,36 @@ grub_rescue_cmd_info (struct grub_command *cmd __attribute__ ((unused)),
     char *argv[] __attribute__ ((unused)))
 {
   unsigned long hits, misses;
+  unsigned sets, ways;
+  grub_disk_dev_t dev;
+
+  grub_disk_cache_get_geometry (&sets, &ways);
+  grub_printf_ (N_("Disk cache: %u sets of %u entries of %u bytes\n"),
+		sets, ways, GRUB_DISK_SECTOR_SIZE << GRUB_DISK_CACHE_BITS);
 
   grub_disk_cache_get_performance (&hits, &misses);
   if (hits + misses)
     {
       unsigned long ratio = hits * 10000 / (hits + misses);
-      grub_printf ("(%lu.%lu%%)\n", ratio / 100, ratio % 100);
       grub_printf_ (N_("Disk cache statistics: hits = %lu (%lu.%02lu%%),"
-		     " misses = %lu\n"), ratio / 100, ratio % 100,
-		    hits, misses);
+		     " misses = %lu\n"), hits, ratio / 100, ratio % 100,
+		    misses);
     }
   else
     grub_printf ("%s\n", _("No disk cache statistics available\n"));    
 
+  for (dev = grub_disk_dev_list; dev; dev = dev->next)
+    {
+      unsigned long entries;
+
+      grub_disk_cache_get_dev_performance (dev->id, &hits, &misses,
+					   &entries);
+      if (!(hits + misses) && !entries)
+	continue;
+      grub_printf_ (N_("%s: hits = %lu, misses = %lu, cached entries = %lu\n"),
+		    dev->name, hits, misses, entries);
+    }
+
  return 0;
 }
 
@@ -19,6 +19,7 @@
 #include <grub/dl.h>
 #include <grub/extcmd.h>
 #include <grub/file.h>
+#include <grub/bufio.h>
 #include <grub/disk.h>
 #include <grub/mm.h>
 #include <grub/misc.h>
@@ -96,7 +97,7 @@ check_list (const gcry_md_spec_t *hash, const char *hashfilename,
   unsigned i;
   unsigned unread = 0, mismatch = 0;
 
-  hashlist = grub_file_open (hashfilename);
+  hashlist = grub_buffile_open (hashfilename, 0);
   if (!hashlist)
     return grub_errno;
   
@@ -23,6 +23,7 @@
 #include <grub/err.h>
 #include <grub/dl.h>
 #include <grub/file.h>
+#include <grub/bufio.h>
 #include <grub/normal.h>
 #include <grub/script_sh.h>
 #include <grub/i18n.h>
@@ -55,7 +56,7 @@ legacy_file (const char *filename)
   if (!suffix)
     return grub_errno;
 
-  file = grub_file_open (filename);
+  file = grub_buffile_open (filename, 0);
   if (! file)
     return grub_errno;
 
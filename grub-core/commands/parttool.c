@@ -25,6 +25,7 @@
 #include <grub/dl.h>
 #include <grub/normal.h>
 #include <grub/device.h>
+#include <grub/bufio.h>
 #include <grub/disk.h>
 #include <grub/partition.h>
 #include <grub/parttool.h>
@@ -193,7 +194,7 @@ grub_cmd_parttool (grub_command_t cmd __attribute__ ((unused)),
 	  {
 	    grub_file_t file;
 
-	    file = grub_file_open (filename);
+	    file = grub_buffile_open (filename, 0);
 	    if (file)
 	      {
 		char *buf = 0;
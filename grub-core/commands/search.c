@@ -30,6 +30,7 @@
 #include <grub/i18n.h>
 #include <grub/disk.h>
 #include <grub/partition.h>
+#include <grub/lib/envblk.h>
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
@@ -42,6 +43,187 @@ struct cache_entry
 
 static struct cache_entry *cache;
 
+/* Prefix of the variables holding the persistent cache.  */
+#ifdef DO_SEARCH_FILE
+#define PERSISTENT_PREFIX "search_file_"
+#elif defined (DO_SEARCH_FS_UUID)
+#define PERSISTENT_PREFIX "search_uuid_"
+#else
+#define PERSISTENT_PREFIX "search_label_"
+#endif
+
+/* Whether the persistent cache was loaded from the environment block.  */
+static int persistent_loaded;
+
+/* The persistent cache is only used if $search_cache is 1.  */
+static int
+persistent_cache_enabled (void)
+{
+  const char *val;
+
+  val = grub_env_get ("search_cache");
+  return val && grub_strcmp (val, "1") == 0;
+}
+
+/* Compute in ID a checksum of the size and the first two sectors of the
+   disk which device NAME is on.  They hold the MBR or the GPT header with
+   the checksum of the partition entries, so the checksum changes when the
+   disk is replaced or repartitioned.  Sectors are counted in the disk's
+   own sector size, so the GPT header is covered on 4Kn disks too.
+   Return 0 if the disk can't be read.  */
+static int
+get_disk_id (const char *name, grub_uint32_t *id)
+{
+  char *diskname;
+  char *p;
+  grub_disk_t disk;
+  grub_uint8_t *buf;
+  grub_size_t len;
+  grub_uint64_t size;
+  grub_uint32_t hash = 2166136261U;
+  unsigned i;
+
+  diskname = grub_strdup (name);
+  if (! diskname)
+    return 0;
+  for (p = diskname; *p; p++)
+    if (*p == '\\' && p[1] == ',')
+      p++;
+    else if (*p == ',')
+      {
+	*p = '\0';
+	break;
+      }
+
+  disk = grub_disk_open (diskname);
+  grub_free (diskname);
+  if (! disk)
+    return 0;
+  size = grub_disk_get_size (disk);
+  len = (grub_size_t) 2 << disk->log_sector_size;
+  buf = grub_malloc (len);
+  if (! buf || grub_disk_read (disk, 0, 0, len, buf))
+    {
+      grub_free (buf);
+      grub_disk_close (disk);
+      return 0;
+    }
+  grub_disk_close (disk);
+
+  /* FNV-1a.  */
+  for (i = 0; i < sizeof (size); i++)
+    hash = (hash ^ ((size >> (8 * i)) & 0xff)) * 16777619U;
+  for (i = 0; i < len; i++)
+    hash = (hash ^ buf[i]) * 16777619U;
+  grub_free (buf);
+
+  *id = hash;
+  return 1;
+}
+
+/* Helper for persistent_cache_load.  */
+static int
+load_persistent_entry (const char *name, const char *value)
+{
+  if (grub_strncmp (name, PERSISTENT_PREFIX,
+		    sizeof (PERSISTENT_PREFIX) - 1) == 0
+      && ! grub_env_get (name))
+    grub_env_set (name, value);
+  return 0;
+}
+
+/* Import the entries of the persistent cache from the environment block
+   under $prefix, unless they are already in the environment.  */
+static void
+persistent_cache_load (void)
+{
+  const char *prefix;
+  char *filename;
+  grub_file_t file;
+  grub_envblk_t envblk = NULL;
+  grub_size_t size;
+  char *buf;
+
+  if (persistent_loaded)
+    return;
+
+  prefix = grub_env_get ("prefix");
+  if (! prefix)
+    return;
+  persistent_loaded = 1;
+
+  filename = grub_xasprintf ("%s/" GRUB_ENVBLK_DEFCFG, prefix);
+  if (! filename)
+    goto out;
+  grub_file_filter_disable_compression ();
+  file = grub_file_open (filename);
+  grub_free (filename);
+  if (! file)
+    goto out;
+
+  size = grub_file_size (file);
+  buf = grub_malloc (size);
+  if (buf && grub_file_read (file, buf, size) == (grub_ssize_t) size)
+    envblk = grub_envblk_open (buf, size);
+  grub_file_close (file);
+  if (! envblk)
+    {
+      grub_free (buf);
+      goto out;
+    }
+
+  grub_envblk_iterate (envblk, load_persistent_entry);
+  grub_envblk_close (envblk);
+
+ out:
+  grub_errno = GRUB_ERR_NONE;
+}
+
+/* Record in the persistent cache that KEY was found on device NAME, along
+   with the identity of its disk.  The environment block is only rewritten
+   when the entry changed, through save_env, which is loaded on demand so
+   that search doesn't depend on loadenv.  */
+static void
+persistent_cache_store (const char *key, const char *name)
+{
+  char *varname, *value;
+  const char *old;
+  char *argv[1];
+  grub_uint32_t id;
+
+  /* Such keys can't be stored in the environment block.  */
+  if (grub_strchr (key, '=') || grub_strchr (key, '\n'))
+    return;
+
+  if (! get_disk_id (name, &id))
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+
+  varname = grub_xasprintf (PERSISTENT_PREFIX "%s", key);
+  value = grub_xasprintf ("%s %08x", name, id);
+  if (! varname || ! value)
+    goto out;
+
+  old = grub_env_get (varname);
+  if (old && grub_strcmp (old, value) == 0)
+    goto out;
+
+  if (grub_env_set (varname, value))
+    goto out;
+  argv[0] = varname;
+  if (! grub_command_find ("save_env"))
+    grub_dl_load ("loadenv");
+  if (grub_command_find ("save_env"))
+    grub_command_execute ("save_env", 1, argv);
+
+ out:
+  grub_free (varname);
+  grub_free (value);
+  grub_errno = GRUB_ERR_NONE;
+}
+
 /* Context for FUNC_NAME.  */
 struct search_ctx
 {
@@ -52,6 +234,8 @@ struct search_ctx
   unsigned nhints;
   int count;
   int is_cache;
+  /* Device to record in the persistent cache once the search is over.  */
+  char *persistent_hit;
 };
 
 /* Helper for FUNC_NAME.  */
@@ -151,6 +335,10 @@ iterate_device (const char *name, void *data)
 	grub_errno = GRUB_ERR_NONE;
     }
 
+  if (!ctx->is_cache && found && ctx->count == 0 && ctx->var
+      && persistent_cache_enabled () && ! ctx->persistent_hit)
+    ctx->persistent_hit = grub_strdup (name);
+
   if (found)
     {
       ctx->count++;
@@ -186,6 +374,55 @@ part_hook (grub_disk_t disk, const grub_partition_t partition, void *data)
   return ret;
 }
 
+/* Helper for FUNC_NAME.  Try the device recorded for CTX->KEY in the
+   persistent cache, provided that its disk still has the same identity.
+   Return nonzero if it was found there.  */
+static int
+persistent_cache_try (struct search_ctx *ctx)
+{
+  char *varname, *name = NULL, *sep, *end;
+  const char *val;
+  grub_uint32_t id;
+  unsigned long stored;
+  int ret = 0;
+
+  persistent_cache_load ();
+
+  varname = grub_xasprintf (PERSISTENT_PREFIX "%s", ctx->key);
+  if (! varname)
+    goto out;
+  val = grub_env_get (varname);
+  grub_free (varname);
+  if (! val)
+    goto out;
+
+  name = grub_strdup (val);
+  if (! name)
+    goto out;
+  sep = grub_strrchr (name, ' ');
+  if (! sep)
+    goto out;
+  *sep = '\0';
+
+  stored = grub_strtoul (sep + 1, &end, 16);
+  if (grub_errno || *end)
+    goto out;
+  if (! get_disk_id (name, &id) || id != stored)
+    {
+      grub_dprintf ("search", "disk of %s changed\n", name);
+      goto out;
+    }
+
+  ctx->is_cache = 1;
+  ret = iterate_device (name, ctx);
+  ctx->is_cache = 0;
+
+ out:
+  grub_free (name);
+  grub_errno = GRUB_ERR_NONE;
+  return ret;
+}
+
 /* Helper for FUNC_NAME.  */
 static void
 try (struct search_ctx *ctx)    
@@ -217,6 +454,10 @@ try (struct search_ctx *ctx)
 	}
     }
 
+  if (ctx->var && persistent_cache_enabled ()
+      && persistent_cache_try (ctx))
+    return;
+
   for (i = 0; i < ctx->nhints; i++)
     {
       char *end;
@@ -271,7 +512,8 @@ FUNC_NAME (const char *key, const char *var, int no_floppy,
     .hints = hints,
     .nhints = nhints,
     .count = 0,
-    .is_cache = 0
+    .is_cache = 0,
+    .persistent_hit = 0
   };
   grub_fs_autoload_hook_t saved_autoload;
 
@@ -292,6 +534,17 @@ FUNC_NAME (const char *key, const char *var, int no_floppy,
   else
     try (&ctx);
 
+  /* Don't write to a disk in the middle of the scan.  */
+  if (ctx.persistent_hit)
+    {
+      grub_err_t err = grub_errno;
+
+      grub_errno = GRUB_ERR_NONE;
+      persistent_cache_store (key, ctx.persistent_hit);
+      grub_free (ctx.persistent_hit);
+      grub_errno = err;
+    }
+
   if (grub_errno == GRUB_ERR_NONE && ctx.count == 0)
     grub_error (GRUB_ERR_FILE_NOT_FOUND, "no such device: %s", key);
 }
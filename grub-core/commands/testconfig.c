@@ -0,0 +1,242 @@
+/* testconfig.c - Command to measure configuration file reading speed  */
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grub/mm.h>
+#include <grub/file.h>
+#include <grub/bufio.h>
+#include <grub/time.h>
+#include <grub/misc.h>
+#include <grub/dl.h>
+#include <grub/extcmd.h>
+#include <grub/i18n.h>
+#include <grub/normal.h>
+#include <grub/script_sh.h>
+
+GRUB_MOD_LICENSE ("GPLv3+");
+
+static const struct grub_arg_option options[] =
+  {
+    {"count", 'c', 0, N_("Read each file N times."), N_("N"),
+     ARG_TYPE_INT},
+    {0, 0, 0, 0, 0, 0}
+  };
+
+enum mode
+  {
+    /* grub_file_getline on the file itself.  */
+    MODE_UNBUFFERED,
+    /* grub_file_getline through bufio.  */
+    MODE_BUFFERED,
+    /* Parse the lines from grub_file_getline through bufio, as
+       read_config_file does when it can't read the file at once.  */
+    MODE_PARSE_LINES,
+    /* Read the whole file and parse it, as read_config_file does.  */
+    MODE_PARSE_TEXT
+  };
+
+/* Where the next line is read from.  */
+struct reader
+{
+  grub_file_t file;
+  const char *pos;
+  const char *end;
+};
+
+/* Get the next line which isn't a comment, as read_config_file does.  */
+static grub_err_t
+config_getline (char **line, int cont __attribute__ ((unused)), void *data)
+{
+  struct reader *reader = data;
+
+  while (1)
+    {
+      if (reader->file)
+	*line = grub_file_getline (reader->file);
+      else if (reader->pos < reader->end)
+	{
+	  const char *p;
+	  char *out;
+
+	  p = grub_memchr (reader->pos, '\n', reader->end - reader->pos);
+	  if (! p)
+	    p = reader->end;
+	  *line = out = grub_malloc (p - reader->pos + 1);
+	  if (out)
+	    {
+	      for (; reader->pos < p; reader->pos++)
+		if (*reader->pos != '\r')
+		  *out++ = *reader->pos;
+	      *out = '\0';
+	    }
+	  reader->pos = p < reader->end ? p + 1 : p;
+	}
+      else
+	*line = 0;
+
+      if (! *line)
+	return grub_errno;
+      if ((*line)[0] != '#')
+	return GRUB_ERR_NONE;
+      grub_free (*line);
+    }
+}
+
+/* Read FILENAME COUNT times in MODE.  Store in LINES the number of lines
+   or statements in the file and return the elapsed time in milliseconds.
+   The statements are parsed but not executed, though parsing a function
+   definition does define the function.  */
+static grub_uint64_t
+measure (const char *filename, unsigned count, enum mode mode,
+	 unsigned *lines)
+{
+  grub_uint64_t start;
+  unsigned i;
+
+  start = grub_get_time_ms ();
+  for (i = 0; i < count; i++)
+    {
+      struct reader reader = { 0, 0, 0 };
+      grub_file_t file;
+      char *text = 0;
+      char *line;
+
+      if (mode == MODE_UNBUFFERED)
+	file = grub_file_open (filename);
+      else
+	file = grub_buffile_open (filename, 0);
+      if (! file)
+	return 0;
+
+      if (mode == MODE_PARSE_TEXT)
+	{
+	  grub_off_t size = grub_file_size (file);
+
+	  if (size != GRUB_FILE_SIZE_UNKNOWN && size == (grub_size_t) size)
+	    text = grub_malloc (size + 1);
+	  if (! text || grub_file_read (file, text, size) != (grub_ssize_t) size)
+	    {
+	      grub_free (text);
+	      grub_file_close (file);
+	      if (! grub_errno)
+		grub_error (GRUB_ERR_FILE_READ_ERROR,
+			    N_("premature end of file %s"), filename);
+	      return 0;
+	    }
+	  reader.pos = text;
+	  reader.end = text + size;
+	}
+      else
+	reader.file = file;
+
+      *lines = 0;
+      if (mode == MODE_UNBUFFERED || mode == MODE_BUFFERED)
+	while ((line = grub_file_getline (file)))
+	  {
+	    grub_free (line);
+	    (*lines)++;
+	  }
+      else
+	while (config_getline (&line, 0, &reader) == GRUB_ERR_NONE && line)
+	  {
+	    struct grub_script *script;
+
+	    script = grub_script_parse (line, config_getline, &reader);
+	    grub_free (line);
+	    if (script)
+	      grub_script_unref (script);
+	    grub_errno = GRUB_ERR_NONE;
+	    (*lines)++;
+	  }
+
+      grub_free (text);
+      grub_file_close (file);
+      if (grub_errno)
+	return 0;
+    }
+
+  return grub_get_time_ms () - start;
+}
+
+static grub_err_t
+grub_cmd_testconfig (grub_extcmd_context_t ctxt, int argc, char **args)
+{
+  struct grub_arg_list *state = ctxt->state;
+  unsigned count = 1;
+  int i;
+
+  if (argc == 0)
+    return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("filename expected"));
+
+  if (state[0].set)
+    {
+      count = grub_strtoul (state[0].arg, 0, 0);
+      if (grub_errno)
+	return grub_errno;
+      if (count == 0)
+	return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("invalid count"));
+    }
+
+  for (i = 0; i < argc; i++)
+    {
+      grub_uint64_t unbuffered, buffered, parse_lines, parse_text;
+      unsigned lines, statements;
+
+      unbuffered = measure (args[i], count, MODE_UNBUFFERED, &lines);
+      if (grub_errno)
+	break;
+      buffered = measure (args[i], count, MODE_BUFFERED, &lines);
+      if (grub_errno)
+	break;
+      parse_lines = measure (args[i], count, MODE_PARSE_LINES, &statements);
+      if (grub_errno)
+	break;
+      parse_text = measure (args[i], count, MODE_PARSE_TEXT, &statements);
+      if (grub_errno)
+	break;
+
+      grub_printf_ (N_("%s: %u lines, %u statements\n"), args[i],
+		    lines, statements);
+      grub_printf_ (N_("Unbuffered getline: %llu ms\n"),
+		    (unsigned long long) unbuffered);
+      grub_printf_ (N_("Buffered getline: %llu ms\n"),
+		    (unsigned long long) buffered);
+      grub_printf_ (N_("Buffered getline and parse: %llu ms\n"),
+		    (unsigned long long) parse_lines);
+      grub_printf_ (N_("Whole file read and parse: %llu ms\n"),
+		    (unsigned long long) parse_text);
+    }
+
+  return grub_errno;
+}
+
+static grub_extcmd_t cmd;
+
+GRUB_MOD_INIT(testconfig)
+{
+  cmd = grub_register_extcmd ("testconfig", grub_cmd_testconfig, 0,
+			      N_("[-c N] FILE..."),
+			      N_("Measure how long reading and parsing a"
+				 " configuration file takes."),
+			      options);
+}
+
+GRUB_MOD_FINI(testconfig)
+{
+  grub_unregister_extcmd (cmd);
+}
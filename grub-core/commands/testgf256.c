@@ -0,0 +1,198 @@
+/* testgf256.c - Command to measure GF(2^8) multiplication speed  */
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grub/gf256.h>
+#include <grub/mm.h>
+#include <grub/time.h>
+#include <grub/misc.h>
+#include <grub/dl.h>
+#include <grub/extcmd.h>
+#include <grub/i18n.h>
+#include <grub/normal.h>
+
+GRUB_MOD_LICENSE ("GPLv3+");
+
+#define DEFAULT_SIZE	1024
+#define DEFAULT_COUNT	64
+#define VERIFY_SIZE	4096
+
+static const struct grub_arg_option options[] =
+  {
+    {"size", 's', 0, N_("Buffer size in KiB."), N_("KiB"), ARG_TYPE_INT},
+    {"count", 'c', 0, N_("Multiply the buffer N times."), N_("N"),
+     ARG_TYPE_INT},
+    {0, 0, 0, 0, 0, 0}
+  };
+
+/* Return the speed of FUNC in bytes per second times 100, as expected by
+   grub_get_human_size, or 0 if the elapsed time was too short.  */
+static grub_uint64_t
+measure (void (*func) (grub_uint8_t *dst, const grub_uint8_t *src,
+		       grub_size_t size, grub_uint8_t c),
+	 grub_uint8_t *dst, const grub_uint8_t *src, grub_size_t size,
+	 unsigned count)
+{
+  grub_uint64_t start, end;
+  unsigned i;
+
+  start = grub_get_time_ms ();
+  for (i = 0; i < count; i++)
+    func (dst, src, size, 0x8e + i);
+  end = grub_get_time_ms ();
+
+  if (end == start)
+    return 0;
+  return grub_divmod64 ((grub_uint64_t) size * count * 100ULL * 1000ULL,
+			end - start, 0);
+}
+
+/* Compare grub_gf256_mul_region and grub_gf256_mul_xor_region, with the
+   kernel currently selected by grub_gf256_simd, against the log table
+   versions for every constant and for lengths and alignments that leave
+   unaligned heads and tails.  SRC must hold at least VERIFY_SIZE + 16
+   bytes and DST and REF VERIFY_SIZE bytes each.  */
+static grub_err_t
+verify (const char *name, grub_uint8_t *dst, grub_uint8_t *ref,
+	const grub_uint8_t *src)
+{
+  unsigned c;
+
+  for (c = 0; c < 256; c++)
+    {
+      grub_size_t off = c % 16, len = VERIFY_SIZE - c % 61;
+
+      grub_memcpy (dst, src + 16 - off, len);
+      grub_memcpy (ref, src + 16 - off, len);
+      grub_gf256_mul_xor_region (dst, src + off, len, c);
+      grub_gf256_mul_xor_region_table (ref, src + off, len, c);
+      if (grub_memcmp (dst, ref, len) != 0)
+	return grub_error (GRUB_ERR_TEST_FAILURE,
+			   "%s: wrong multiply-xor result for 0x%02x",
+			   name, c);
+
+      grub_gf256_mul_region (dst, src + off, len, c);
+      grub_gf256_mul_region_table (ref, src + off, len, c);
+      if (grub_memcmp (dst, ref, len) != 0)
+	return grub_error (GRUB_ERR_TEST_FAILURE,
+			   "%s: wrong multiply result for 0x%02x", name, c);
+    }
+
+  return GRUB_ERR_NONE;
+}
+
+static void
+print_speed (const char *name, grub_uint64_t speed, grub_uint64_t ref)
+{
+  if (!speed || !ref)
+    {
+      grub_printf_ (N_("%s: too fast to measure, use a larger count\n"),
+		    name);
+      return;
+    }
+  grub_printf ("%s: %s (%d.%02dx)\n", name,
+	       grub_get_human_size (speed, GRUB_HUMAN_SIZE_SPEED),
+	       (int) grub_divmod64 (speed, ref, 0),
+	       (int) grub_divmod64 (speed * 100, ref, 0) % 100);
+}
+
+static grub_err_t
+grub_cmd_testgf256 (grub_extcmd_context_t ctxt,
+		    int argc __attribute__ ((unused)),
+		    char **args __attribute__ ((unused)))
+{
+  struct grub_arg_list *state = ctxt->state;
+  grub_size_t size = DEFAULT_SIZE, alloc_size;
+  unsigned count = DEFAULT_COUNT;
+  grub_uint8_t *src = 0, *dst = 0, *ref_dst = 0;
+  grub_uint64_t ref, speed;
+  int simd = grub_gf256_simd;
+  grub_size_t i;
+
+  if (state[0].set)
+    size = grub_strtoul (state[0].arg, 0, 0);
+  if (state[1].set)
+    count = grub_strtoul (state[1].arg, 0, 0);
+  if (grub_errno)
+    return grub_errno;
+  if (size == 0 || count == 0)
+    return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("invalid argument"));
+  size <<= 10;
+
+  alloc_size = size < VERIFY_SIZE + 16 ? VERIFY_SIZE + 16 : size;
+
+  src = grub_malloc (alloc_size);
+  dst = grub_zalloc (alloc_size);
+  ref_dst = grub_malloc (VERIFY_SIZE);
+  if (!src || !dst || !ref_dst)
+    goto out;
+  for (i = 0; i < alloc_size; i++)
+    src[i] = i * 7 + (i >> 8);
+
+  grub_gf256_init ();
+  simd = grub_gf256_simd;
+
+  /* Check every kernel before timing any of them.  */
+  grub_gf256_simd = 0;
+  if (verify (_("Product table"), dst, ref_dst, src))
+    goto out;
+  if (simd)
+    {
+      grub_gf256_simd = 1;
+      if (verify (_("SSSE3"), dst, ref_dst, src))
+	goto out;
+    }
+  grub_gf256_simd = simd;
+
+  ref = measure (grub_gf256_mul_xor_region_table, dst, src, size, count);
+  print_speed (_("Log tables"), ref, ref);
+
+  grub_gf256_simd = 0;
+  speed = measure (grub_gf256_mul_xor_region, dst, src, size, count);
+  print_speed (_("Product table"), speed, ref);
+
+  if (simd)
+    {
+      grub_gf256_simd = 1;
+      speed = measure (grub_gf256_mul_xor_region, dst, src, size, count);
+      print_speed (_("SSSE3"), speed, ref);
+    }
+
+ out:
+  grub_gf256_simd = simd;
+  grub_free (src);
+  grub_free (dst);
+  grub_free (ref_dst);
+
+  return grub_errno;
+}
+
+static grub_extcmd_t cmd;
+
+GRUB_MOD_INIT(testgf256)
+{
+  cmd = grub_register_extcmd ("testgf256", grub_cmd_testgf256, 0,
+			      N_("[-s KiB] [-c N]"),
+			      N_("Measure RAID6 GF(2^8) multiplication speed."),
+			      options);
+}
+
+GRUB_MOD_FINI(testgf256)
+{
+  grub_unregister_extcmd (cmd);
+}
@@ -0,0 +1,171 @@
+/* testgzio.c - Command to compare gzio decompression speed  */
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grub/mm.h>
+#include <grub/file.h>
+#include <grub/time.h>
+#include <grub/misc.h>
+#include <grub/env.h>
+#include <grub/dl.h>
+#include <grub/extcmd.h>
+#include <grub/i18n.h>
+#include <grub/normal.h>
+
+GRUB_MOD_LICENSE ("GPLv3+");
+
+#define BLOCK_SIZE	65536
+
+static const struct grub_arg_option options[] =
+  {
+    {"count", 'c', 0, N_("Decompress each file N times."), N_("N"),
+     ARG_TYPE_INT},
+    {0, 0, 0, 0, 0, 0}
+  };
+
+/* Decompress FILENAME COUNT times and return the speed in bytes per
+   second times 100, as expected by grub_get_human_size, or 0 if the
+   elapsed time was too short to measure.  */
+static grub_uint64_t
+measure (const char *filename, unsigned count, char *buffer,
+	 grub_uint64_t *total_size)
+{
+  grub_uint64_t start, end;
+  unsigned i;
+
+  *total_size = 0;
+  start = grub_get_time_ms ();
+  for (i = 0; i < count; i++)
+    {
+      grub_file_t file;
+
+      file = grub_file_open (filename);
+      if (! file)
+	return 0;
+
+      while (1)
+	{
+	  grub_ssize_t size = grub_file_read (file, buffer, BLOCK_SIZE);
+	  if (size <= 0)
+	    break;
+	  *total_size += size;
+	}
+      grub_file_close (file);
+      if (grub_errno)
+	return 0;
+    }
+  end = grub_get_time_ms ();
+
+  if (end == start)
+    return 0;
+  return grub_divmod64 (*total_size * 100ULL * 1000ULL, end - start, 0);
+}
+
+static grub_err_t
+grub_cmd_testgzio (grub_extcmd_context_t ctxt, int argc, char **args)
+{
+  struct grub_arg_list *state = ctxt->state;
+  const char *val;
+  char *saved = 0;
+  char *buffer;
+  unsigned count = 1;
+  int i;
+
+  if (argc == 0)
+    return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("filename expected"));
+
+  if (state[0].set)
+    {
+      count = grub_strtoul (state[0].arg, 0, 0);
+      if (grub_errno)
+	return grub_errno;
+      if (count == 0)
+	return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("invalid count"));
+    }
+
+  buffer = grub_malloc (BLOCK_SIZE);
+  if (! buffer)
+    return grub_errno;
+
+  val = grub_env_get ("gzio_fast_inflate");
+  if (val)
+    {
+      saved = grub_strdup (val);
+      if (! saved)
+	{
+	  grub_free (buffer);
+	  return grub_errno;
+	}
+    }
+
+  for (i = 0; i < argc; i++)
+    {
+      grub_uint64_t ref, fast;
+      grub_uint64_t total_size;
+
+      grub_env_set ("gzio_fast_inflate", "0");
+      ref = measure (args[i], count, buffer, &total_size);
+      if (grub_errno)
+	break;
+      grub_env_set ("gzio_fast_inflate", "1");
+      fast = measure (args[i], count, buffer, &total_size);
+      if (grub_errno)
+	break;
+
+      grub_printf ("%s: %s\n", args[i],
+		   grub_get_human_size (total_size / count,
+					GRUB_HUMAN_SIZE_NORMAL));
+      if (! ref || ! fast)
+	{
+	  grub_printf_ (N_("Too fast to measure, use a larger count.\n"));
+	  continue;
+	}
+      grub_printf_ (N_("Reference decoder: %s\n"),
+		    grub_get_human_size (ref, GRUB_HUMAN_SIZE_SPEED));
+      grub_printf_ (N_("Fast decoder: %s\n"),
+		    grub_get_human_size (fast, GRUB_HUMAN_SIZE_SPEED));
+      grub_printf_ (N_("Speedup: %d.%02d\n"),
+		    (int) grub_divmod64 (fast, ref, 0),
+		    (int) grub_divmod64 (fast * 100, ref, 0) % 100);
+    }
+
+  if (saved)
+    grub_env_set ("gzio_fast_inflate", saved);
+  else
+    grub_env_unset ("gzio_fast_inflate");
+  grub_free (saved);
+  grub_free (buffer);
+
+  return grub_errno;
+}
+
+static grub_extcmd_t cmd;
+
+GRUB_MOD_INIT(testgzio)
+{
+  cmd = grub_register_extcmd ("testgzio", grub_cmd_testgzio, 0,
+			      N_("[-c N] FILE..."),
+			      N_("Compare decompression speed of the reference"
+				 " and fast inflate decoders."),
+			      options);
+}
+
+GRUB_MOD_FINI(testgzio)
+{
+  grub_unregister_extcmd (cmd);
+}
@@ -59,24 +59,6 @@ static inline int GF_PER_SECTOR (const struct grub_cryptodisk *dev)
 static grub_cryptodisk_t cryptodisk_list = NULL;
 static grub_uint8_t n = 0;
 
-static void
-gf_mul_x (grub_uint8_t *g)
-{
-  int over = 0, over2 = 0;
-  unsigned j;
-
-  for (j = 0; j < GRUB_CRYPTODISK_GF_BYTES; j++)
-    {
-      over2 = !!(g[j] & 0x80);
-      g[j] <<= 1;
-      g[j] |= over;
-      over = over2;
-    }
-  if (over)
-    g[0] ^= GF_POLYNOM;
-}
-
-
 static void
 gf_mul_x_be (grub_uint8_t *g)
 {
@@ -216,6 +198,58 @@ lrw_xor (const struct lrw_sector *sec,
 		   dev->lrw_precalc, sec->low_byte * GRUB_CRYPTODISK_GF_BYTES);
 }
 
+/* The number of sectors whose IVs are computed and encrypted at once.  */
+#define IV_BATCH 32
+/* The amount of XTS data whose tweaks are computed at once.  */
+#define XTS_CHUNK 512
+
+/* Process one XTS sector of SIZE bytes at DATA, with TWEAK being the
+   encrypted IV.  The tweaks for a chunk of blocks are computed first, so
+   that the cipher processes the whole chunk in a single call.  */
+static gcry_err_code_t
+grub_cryptodisk_xts (struct grub_cryptodisk *dev, grub_uint8_t *data,
+		     grub_size_t size, const grub_uint8_t *tweak,
+		     int do_encrypt)
+{
+  grub_uint64_t tweaks[XTS_CHUNK / sizeof (grub_uint64_t)];
+  grub_uint64_t lo, hi, over;
+  grub_size_t off, chunk, j;
+  gcry_err_code_t err;
+
+  lo = grub_le_to_cpu64 (grub_get_unaligned64 (tweak));
+  hi = grub_le_to_cpu64 (grub_get_unaligned64 (tweak + 8));
+
+  for (off = 0; off < size; off += chunk)
+    {
+      chunk = size - off;
+      if (chunk > sizeof (tweaks))
+	chunk = sizeof (tweaks);
+
+      /* Multiply the little-endian tweak by x.  */
+      for (j = 0; j < chunk / sizeof (grub_uint64_t); j += 2)
+	{
+	  tweaks[j] = grub_cpu_to_le64 (lo);
+	  tweaks[j + 1] = grub_cpu_to_le64 (hi);
+	  over = hi >> 63;
+	  hi = (hi << 1) | (lo >> 63);
+	  lo = (lo << 1) ^ (over * GF_POLYNOM);
+	}
+
+      grub_crypto_xor (data + off, data + off, tweaks, chunk);
+      if (do_encrypt)
+	err = grub_crypto_ecb_encrypt (dev->cipher, data + off, data + off,
+				       chunk);
+      else
+	err = grub_crypto_ecb_decrypt (dev->cipher, data + off, data + off,
+				       chunk);
+      if (err)
+	return err;
+      grub_crypto_xor (data + off, data + off, tweaks, chunk);
+    }
+
+  return GPG_ERR_NO_ERROR;
+}
+
 static gcry_err_code_t
 grub_cryptodisk_endecrypt (struct grub_cryptodisk *dev,
 			   grub_uint8_t * data, grub_size_t len,
@@ -223,22 +257,32 @@ grub_cryptodisk_endecrypt (struct grub_cryptodisk *dev,
 {
   grub_size_t i;
   gcry_err_code_t err;
+  grub_size_t blocksize = dev->cipher->cipher->blocksize;
+  grub_size_t sz = ((blocksize + sizeof (grub_uint32_t) - 1)
+		    / sizeof (grub_uint32_t));
+  grub_uint32_t ivs[IV_BATCH * sz];
 
   /* The only mode without IV.  */
   if (dev->mode == GRUB_CRYPTODISK_MODE_ECB && !dev->rekey)
     return (do_encrypt ? grub_crypto_ecb_encrypt (dev->cipher, data, data, len)
 	    : grub_crypto_ecb_decrypt (dev->cipher, data, data, len));
 
-  for (i = 0; i < len; i += (1U << dev->log_sector_size))
+  /* Process the request in batches of sectors, so that the IVs of a batch
+     can be encrypted together.  */
+  for (i = 0; i < len; )
     {
-      grub_size_t sz = ((dev->cipher->cipher->blocksize
-			 + sizeof (grub_uint32_t) - 1)
-			/ sizeof (grub_uint32_t));
-      grub_uint32_t iv[sz];
+      grub_size_t nsec, j;
+
+      nsec = ((len - i + (1U << dev->log_sector_size) - 1)
+	      >> dev->log_sector_size);
+      if (nsec > IV_BATCH)
+	nsec = IV_BATCH;
 
       if (dev->rekey)
 	{
 	  grub_uint64_t zone = sector >> dev->rekey_shift;
+	  grub_uint64_t zone_end = (zone + 1) << dev->rekey_shift;
+
 	  if (zone != dev->last_rekey)
 	    {
 	      err = dev->rekey (dev, zone);
@@ -246,138 +290,145 @@ grub_cryptodisk_endecrypt (struct grub_cryptodisk *dev,
 		return err;
 	      dev->last_rekey = zone;
 	    }
+	  /* Don't let a batch cross into the next key.  */
+	  if (nsec > zone_end - sector)
+	    nsec = zone_end - sector;
 	}
 
-      grub_memset (iv, 0, sz * sizeof (iv[0]));
-      switch (dev->mode_iv)
+      grub_memset (ivs, 0, nsec * sz * sizeof (ivs[0]));
+      for (j = 0; j < nsec; j++)
 	{
-	case GRUB_CRYPTODISK_MODE_IV_NULL:
-	  break;
-	case GRUB_CRYPTODISK_MODE_IV_BYTECOUNT64_HASH:
-	  {
-	    grub_uint64_t tmp;
-	    GRUB_PROPERLY_ALIGNED_ARRAY (ctx, dev->iv_hash->contextsize);
+	  grub_uint32_t *iv = ivs + j * sz;
+	  grub_disk_addr_t s = sector + j;
 
-	    grub_memset (ctx, 0, sizeof (ctx));
+	  switch (dev->mode_iv)
+	    {
+	    case GRUB_CRYPTODISK_MODE_IV_NULL:
+	      break;
+	    case GRUB_CRYPTODISK_MODE_IV_BYTECOUNT64_HASH:
+	      {
+		grub_uint64_t tmp;
+		GRUB_PROPERLY_ALIGNED_ARRAY (ctx, dev->iv_hash->contextsize);
 
-	    tmp = grub_cpu_to_le64 (sector << dev->log_sector_size);
-	    dev->iv_hash->init (ctx);
-	    dev->iv_hash->write (ctx, dev->iv_prefix, dev->iv_prefix_len);
-	    dev->iv_hash->write (ctx, &tmp, sizeof (tmp));
-	    dev->iv_hash->final (ctx);
+		grub_memset (ctx, 0, sizeof (ctx));
 
-	    grub_memcpy (iv, dev->iv_hash->read (ctx), sizeof (iv));
-	  }
-	  break;
-	case GRUB_CRYPTODISK_MODE_IV_PLAIN64:
-	  iv[1] = grub_cpu_to_le32 (sector >> 32);
-	case GRUB_CRYPTODISK_MODE_IV_PLAIN:
-	  iv[0] = grub_cpu_to_le32 (sector & 0xFFFFFFFF);
-	  break;
-	case GRUB_CRYPTODISK_MODE_IV_BYTECOUNT64:
-	  iv[1] = grub_cpu_to_le32 (sector >> (32 - dev->log_sector_size));
-	  iv[0] = grub_cpu_to_le32 ((sector << dev->log_sector_size)
-				    & 0xFFFFFFFF);
-	  break;
-	case GRUB_CRYPTODISK_MODE_IV_BENBI:
-	  {
-	    grub_uint64_t num = (sector << dev->benbi_log) + 1;
-	    iv[sz - 2] = grub_cpu_to_be32 (num >> 32);
-	    iv[sz - 1] = grub_cpu_to_be32 (num & 0xFFFFFFFF);
-	  }
-	  break;
-	case GRUB_CRYPTODISK_MODE_IV_ESSIV:
-	  iv[0] = grub_cpu_to_le32 (sector & 0xFFFFFFFF);
-	  err = grub_crypto_ecb_encrypt (dev->essiv_cipher, iv, iv,
-					 dev->cipher->cipher->blocksize);
-	  if (err)
-	    return err;
+		tmp = grub_cpu_to_le64 (s << dev->log_sector_size);
+		dev->iv_hash->init (ctx);
+		dev->iv_hash->write (ctx, dev->iv_prefix, dev->iv_prefix_len);
+		dev->iv_hash->write (ctx, &tmp, sizeof (tmp));
+		dev->iv_hash->final (ctx);
+
+		grub_memcpy (iv, dev->iv_hash->read (ctx),
+			     sz * sizeof (iv[0]));
+	      }
+	      break;
+	    case GRUB_CRYPTODISK_MODE_IV_PLAIN64:
+	      iv[1] = grub_cpu_to_le32 (s >> 32);
+	    case GRUB_CRYPTODISK_MODE_IV_PLAIN:
+	      iv[0] = grub_cpu_to_le32 (s & 0xFFFFFFFF);
+	      break;
+	    case GRUB_CRYPTODISK_MODE_IV_BYTECOUNT64:
+	      iv[1] = grub_cpu_to_le32 (s >> (32 - dev->log_sector_size));
+	      iv[0] = grub_cpu_to_le32 ((s << dev->log_sector_size)
+					& 0xFFFFFFFF);
+	      break;
+	    case GRUB_CRYPTODISK_MODE_IV_BENBI:
+	      {
+		grub_uint64_t num = (s << dev->benbi_log) + 1;
+		iv[sz - 2] = grub_cpu_to_be32 (num >> 32);
+		iv[sz - 1] = grub_cpu_to_be32 (num & 0xFFFFFFFF);
+	      }
+	      break;
+	    case GRUB_CRYPTODISK_MODE_IV_ESSIV:
+	      iv[0] = grub_cpu_to_le32 (s & 0xFFFFFFFF);
+	      break;
+	    }
 	}
 
-      switch (dev->mode)
+      if (dev->mode_iv == GRUB_CRYPTODISK_MODE_IV_ESSIV)
 	{
-	case GRUB_CRYPTODISK_MODE_CBC:
-	  if (do_encrypt)
-	    err = grub_crypto_cbc_encrypt (dev->cipher, data + i, data + i,
-					   (1U << dev->log_sector_size), iv);
-	  else
-	    err = grub_crypto_cbc_decrypt (dev->cipher, data + i, data + i,
-					   (1U << dev->log_sector_size), iv);
+	  err = grub_crypto_ecb_encrypt (dev->essiv_cipher, ivs, ivs,
+					 nsec * sz * sizeof (ivs[0]));
 	  if (err)
 	    return err;
-	  break;
+	}
 
-	case GRUB_CRYPTODISK_MODE_PCBC:
-	  if (do_encrypt)
-	    err = grub_crypto_pcbc_encrypt (dev->cipher, data + i, data + i,
-					    (1U << dev->log_sector_size), iv);
-	  else
-	    err = grub_crypto_pcbc_decrypt (dev->cipher, data + i, data + i,
-					    (1U << dev->log_sector_size), iv);
+      /* The XTS tweak is the IV encrypted with the secondary key.  */
+      if (dev->mode == GRUB_CRYPTODISK_MODE_XTS)
+	{
+	  err = grub_crypto_ecb_encrypt (dev->secondary_cipher, ivs, ivs,
+					 nsec * sz * sizeof (ivs[0]));
 	  if (err)
 	    return err;
-	  break;
-	case GRUB_CRYPTODISK_MODE_XTS:
-	  {
-	    unsigned j;
-	    err = grub_crypto_ecb_encrypt (dev->secondary_cipher, iv, iv,
-					   dev->cipher->cipher->blocksize);
-	    if (err)
-	      return err;
-	    
-	    for (j = 0; j < (1U << dev->log_sector_size);
-		 j += dev->cipher->cipher->blocksize)
+	}
+
+      for (j = 0; j < nsec; j++, i += (1U << dev->log_sector_size))
+	{
+	  grub_uint32_t *iv = ivs + j * sz;
+
+	  switch (dev->mode)
+	    {
+	    case GRUB_CRYPTODISK_MODE_CBC:
+	      if (do_encrypt)
+		err = grub_crypto_cbc_encrypt (dev->cipher, data + i, data + i,
+					       (1U << dev->log_sector_size), iv);
+	      else
+		err = grub_crypto_cbc_decrypt (dev->cipher, data + i, data + i,
+					       (1U << dev->log_sector_size), iv);
+	      if (err)
+		return err;
+	      break;
+
+	    case GRUB_CRYPTODISK_MODE_PCBC:
+	      if (do_encrypt)
+		err = grub_crypto_pcbc_encrypt (dev->cipher, data + i, data + i,
+						(1U << dev->log_sector_size), iv);
+	      else
+		err = grub_crypto_pcbc_decrypt (dev->cipher, data + i, data + i,
+						(1U << dev->log_sector_size), iv);
+	      if (err)
+		return err;
+	      break;
+	    case GRUB_CRYPTODISK_MODE_XTS:
+	      err = grub_cryptodisk_xts (dev, data + i,
+					 (1U << dev->log_sector_size),
+					 (grub_uint8_t *) iv, do_encrypt);
+	      if (err)
+		return err;
+	      break;
+	    case GRUB_CRYPTODISK_MODE_LRW:
 	      {
-		grub_crypto_xor (data + i + j, data + i + j, iv,
-				 dev->cipher->cipher->blocksize);
+		struct lrw_sector sec;
+
+		generate_lrw_sector (&sec, dev, (grub_uint8_t *) iv);
+		lrw_xor (&sec, dev, data + i);
+
 		if (do_encrypt)
-		  err = grub_crypto_ecb_encrypt (dev->cipher, data + i + j, 
-						 data + i + j,
-						 dev->cipher->cipher->blocksize);
+		  err = grub_crypto_ecb_encrypt (dev->cipher, data + i, 
+						 data + i,
+						 (1U << dev->log_sector_size));
 		else
-		  err = grub_crypto_ecb_decrypt (dev->cipher, data + i + j, 
-						 data + i + j,
-						 dev->cipher->cipher->blocksize);
+		  err = grub_crypto_ecb_decrypt (dev->cipher, data + i, 
+						 data + i,
+						 (1U << dev->log_sector_size));
 		if (err)
 		  return err;
-		grub_crypto_xor (data + i + j, data + i + j, iv,
-				 dev->cipher->cipher->blocksize);
-		gf_mul_x ((grub_uint8_t *) iv);
+		lrw_xor (&sec, dev, data + i);
 	      }
-	  }
-	  break;
-	case GRUB_CRYPTODISK_MODE_LRW:
-	  {
-	    struct lrw_sector sec;
-
-	    generate_lrw_sector (&sec, dev, (grub_uint8_t *) iv);
-	    lrw_xor (&sec, dev, data + i);
-
-	    if (do_encrypt)
-	      err = grub_crypto_ecb_encrypt (dev->cipher, data + i, 
-					     data + i,
-					     (1U << dev->log_sector_size));
-	    else
-	      err = grub_crypto_ecb_decrypt (dev->cipher, data + i, 
-					     data + i,
-					     (1U << dev->log_sector_size));
-	    if (err)
-	      return err;
-	    lrw_xor (&sec, dev, data + i);
-	  }
-	  break;
-	case GRUB_CRYPTODISK_MODE_ECB:
-	  if (do_encrypt)
-	    grub_crypto_ecb_encrypt (dev->cipher, data + i, data + i,
-				     (1U << dev->log_sector_size));
-	  else
-	    grub_crypto_ecb_decrypt (dev->cipher, data + i, data + i,
-				     (1U << dev->log_sector_size));
-	  break;
-	default:
-	  return GPG_ERR_NOT_IMPLEMENTED;
+	      break;
+	    case GRUB_CRYPTODISK_MODE_ECB:
+	      if (do_encrypt)
+		grub_crypto_ecb_encrypt (dev->cipher, data + i, data + i,
+					 (1U << dev->log_sector_size));
+	      else
+		grub_crypto_ecb_decrypt (dev->cipher, data + i, data + i,
+					 (1U << dev->log_sector_size));
+	      break;
+	    default:
+	      return GPG_ERR_NOT_IMPLEMENTED;
+	    }
 	}
-      sector++;
+      sector += nsec;
     }
   return GPG_ERR_NO_ERROR;
 }
@@ -814,10 +865,14 @@ grub_cryptodisk_scan_device_real (const char *name, grub_disk_t source)
       return err;
     }
 
-    grub_cryptodisk_insert (dev, name, source);
+    if (grub_cryptodisk_insert (dev, name, source))
+      return grub_errno;
 
     have_it = 1;
 
+    if (dev->unlocked)
+      dev->unlocked (dev);
+
     return GRUB_ERR_NONE;
   }
   return GRUB_ERR_NONE;
@@ -1094,6 +1149,10 @@ static grub_extcmd_t cmd;
 
 GRUB_MOD_INIT (cryptodisk)
 {
+#if defined (__x86_64__) && defined (GRUB_MACHINE_EFI)
+  /* The bulk AES code is only loaded as a dependency of cryptodisk.  */
+  grub_aesni_init ();
+#endif
   grub_disk_dev_register (&grub_cryptodisk_dev);
   cmd = grub_register_extcmd ("cryptomount", grub_cmd_cryptomount, 0,
 			      N_("SOURCE|-u UUID|-a|-b"),
@@ -24,6 +24,7 @@
 #include <grub/misc.h>
 #include <grub/diskfilter.h>
 #include <grub/partition.h>
+#include <grub/time.h>
 #ifdef GRUB_UTIL
 #include <grub/i18n.h>
 #include <grub/util/misc.h>
@@ -480,6 +481,62 @@ static grub_err_t
 read_lv (struct grub_diskfilter_lv *lv, grub_disk_addr_t sector,
 	 grub_size_t size, char *buf);
 
+/* Read costs are in 1/16 ms per MiB, and 0 until measured.  The clock
+   may tick only every 55 ms, as with the BIOS timer, so most single reads
+   measure as 0 ms.  Instead the times and sizes of the reads from a volume
+   are added up, which evens out the rounding, and a sample is taken once
+   they reach COST_MIN_MS.  Volumes which failed a read get COST_FAILED so
+   that they are tried last.  */
+#define COST_MIN_MS		250
+#define COST_FAILED		0xffffffff
+
+static void
+update_read_cost (struct grub_diskfilter_pv *pv, grub_err_t err,
+		  grub_uint64_t elapsed, grub_size_t size)
+{
+  grub_uint32_t sample;
+
+  if (err)
+    {
+      if (err == GRUB_ERR_READ_ERROR || err == GRUB_ERR_UNKNOWN_DEVICE)
+	{
+	  pv->read_cost = COST_FAILED;
+	  pv->read_time = 0;
+	  pv->read_sectors = 0;
+	}
+      return;
+    }
+
+  if (pv->read_cost == COST_FAILED)
+    pv->read_cost = 0;
+
+  pv->read_time += elapsed;
+  pv->read_sectors += size;
+  if (pv->read_time < COST_MIN_MS)
+    return;
+
+  sample = grub_divmod64 (pv->read_time * 16 * 2048, pv->read_sectors, 0);
+  if (sample == 0)
+    sample = 1;
+  pv->read_time = 0;
+  pv->read_sectors = 0;
+
+  if (pv->read_cost == 0)
+    pv->read_cost = sample;
+  else
+    pv->read_cost += ((grub_int32_t) (sample - pv->read_cost)) / 4;
+}
+
+static grub_uint32_t
+node_read_cost (const struct grub_diskfilter_node *node)
+{
+  if (!node->pv)
+    return 0;
+  if (!node->pv->disk)
+    return COST_FAILED;
+  return node->pv->read_cost;
+}
+
 grub_err_t
 grub_diskfilter_read_node (const struct grub_diskfilter_node *node,
 			   grub_disk_addr_t sector,
@@ -490,9 +547,17 @@ grub_diskfilter_read_node (const struct grub_diskfilter_node *node,
   if (node->pv)
     {
       if (node->pv->disk)
-	return grub_disk_read (node->pv->disk, sector + node->start
-			       + node->pv->start_sector,
-			       0, size << GRUB_DISK_SECTOR_BITS, buf);
+	{
+	  grub_uint64_t start;
+	  grub_err_t err;
+
+	  start = grub_get_time_ms ();
+	  err = grub_disk_read (node->pv->disk, sector + node->start
+				+ node->pv->start_sector,
+				0, size << GRUB_DISK_SECTOR_BITS, buf);
+	  update_read_cost (node->pv, err, grub_get_time_ms () - start, size);
+	  return err;
+	}
       else
 	return grub_error (GRUB_ERR_UNKNOWN_DEVICE,
 			   N_("physical volume %s not found"), node->pv->name);
@@ -503,6 +568,41 @@ grub_diskfilter_read_node (const struct grub_diskfilter_node *node,
   return grub_error (GRUB_ERR_UNKNOWN_DEVICE, "unknown node '%s'", node->name);
 }
 
+/* Every member of a mirror holds the whole volume at the same offset, so
+   the request is read in one piece from the cheapest member, falling back
+   to the others in order.  */
+static grub_err_t
+read_mirror (struct grub_diskfilter_segment *seg, grub_disk_addr_t sector,
+	     grub_size_t size, char *buf)
+{
+  grub_err_t err = GRUB_ERR_NONE;
+  unsigned int i, best = 0;
+
+  for (i = 1; i < seg->node_count; i++)
+    if (node_read_cost (&seg->nodes[i]) < node_read_cost (&seg->nodes[best]))
+      best = i;
+
+  for (i = 0; i <= seg->node_count; i++)
+    {
+      unsigned int k = i ? i - 1 : best;
+
+      if (i && k == best)
+	continue;
+
+      if (grub_errno == GRUB_ERR_READ_ERROR
+	  || grub_errno == GRUB_ERR_UNKNOWN_DEVICE)
+	grub_errno = GRUB_ERR_NONE;
+
+      err = grub_diskfilter_read_node (&seg->nodes[k], sector, size, buf);
+      if (! err)
+	return GRUB_ERR_NONE;
+      if (err != GRUB_ERR_READ_ERROR && err != GRUB_ERR_UNKNOWN_DEVICE)
+	return err;
+    }
+
+  return err;
+}
+
 static grub_err_t
 read_segment (struct grub_diskfilter_segment *seg, grub_disk_addr_t sector,
 	      grub_size_t size, char *buf)
@@ -515,6 +615,8 @@ read_segment (struct grub_diskfilter_segment *seg, grub_disk_addr_t sector,
 	return grub_diskfilter_read_node (&seg->nodes[0],
 					  sector, size, buf);
     case GRUB_DISKFILTER_MIRROR:
+      if (seg->type == GRUB_DISKFILTER_MIRROR)
+	return read_mirror (seg, sector, size, buf);
     case GRUB_DISKFILTER_RAID10:
       {
 	grub_disk_addr_t read_sector, far_ofs;
@@ -553,17 +655,32 @@ read_segment (struct grub_diskfilter_segment *seg, grub_disk_addr_t sector,
 	while (1)
 	  {
 	    grub_size_t read_size;
+	    unsigned int first = 0;
 
 	    read_size = seg->stripe_size - b;
 	    if (read_size > size)
 	      read_size = size;
 
+	    /* Start with the cheapest of the near copies.  */
+	    for (i = 1; i < near; i++)
+	      if (node_read_cost (&seg->nodes[(disknr + i) % seg->node_count])
+		  < node_read_cost (&seg->nodes[(disknr + first)
+						% seg->node_count]))
+		first = i;
+
 	    err = 0;
 	    for (i = 0; i < near; i++)
 	      {
-		unsigned int k;
+		grub_disk_addr_t copy_sector = read_sector;
+		grub_uint64_t k;
+
+		k = disknr + (first + i) % near;
+		while (k >= seg->node_count)
+		  {
+		    k -= seg->node_count;
+		    copy_sector += ofs;
+		  }
 
-		k = disknr;
 		err = 0;
 		for (j = 0; j < far; j++)
 		  {
@@ -572,7 +689,7 @@ read_segment (struct grub_diskfilter_segment *seg, grub_disk_addr_t sector,
 		      grub_errno = GRUB_ERR_NONE;
 
 		    err = grub_diskfilter_read_node (&seg->nodes[k],
-						     read_sector
+						     copy_sector
 						     + j * far_ofs + b,
 						     read_size,
 						     buf);
@@ -588,13 +705,6 @@ read_segment (struct grub_diskfilter_segment *seg, grub_disk_addr_t sector,
 
 		if (! err)
 		  break;
-
-		disknr++;
-		if (disknr == seg->node_count)
-		  {
-		    disknr = 0;
-		    read_sector += ofs;
-		  }
 	      }
 
 	    if (err)
@@ -606,7 +716,7 @@ read_segment (struct grub_diskfilter_segment *seg, grub_disk_addr_t sector,
 	      return GRUB_ERR_NONE;
 	    
 	    b = 0;
-	    disknr += (near - i);
+	    disknr += near;
 	    while (disknr >= seg->node_count)
 	      {
 		disknr -= seg->node_count;
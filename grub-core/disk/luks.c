@@ -26,12 +26,18 @@
 #include <grub/crypto.h>
 #include <grub/partition.h>
 #include <grub/i18n.h>
+#include <grub/env.h>
+#include <grub/file.h>
+#include <grub/command.h>
+#include <grub/lib/envblk.h>
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
 #define MAX_PASSPHRASE 256
 
 #define LUKS_KEY_ENABLED  0x00AC71F3
+#define LUKS_NUMKEYS      8
+#define LUKS_SLOT_VAR     "luks_slot_"
 
 /* On disk LUKS header */
 struct grub_luks_phdr
@@ -55,7 +61,7 @@ struct grub_luks_phdr
     grub_uint8_t passwordSalt[32];
     grub_uint32_t keyMaterialOffset;
     grub_uint32_t stripes;
-  } keyblock[8];
+  } keyblock[LUKS_NUMKEYS];
 } __attribute__ ((packed));
 
 typedef struct grub_luks_phdr *grub_luks_phdr_t;
@@ -295,6 +301,171 @@ configure_ciphers (grub_disk_t disk, const char *check_uuid,
   return newdev;
 }
 
+/* Check the parameters of key slot I before spending a PBKDF2 run on it.
+   Slots with no iterations or stripes, or whose key material overlaps
+   the header or the payload, cannot yield the master key.  */
+static int
+luks_slot_usable (const struct grub_luks_phdr *header, unsigned i)
+{
+  grub_uint64_t keysize = grub_be_to_cpu32 (header->keyBytes);
+  grub_uint64_t stripes = grub_be_to_cpu32 (header->keyblock[i].stripes);
+  grub_uint64_t start = grub_be_to_cpu32 (header->keyblock[i].keyMaterialOffset);
+  grub_uint64_t end;
+
+  if (grub_be_to_cpu32 (header->keyblock[i].active) != LUKS_KEY_ENABLED)
+    return 0;
+
+  if (stripes == 0
+      || grub_be_to_cpu32 (header->keyblock[i].passwordIterations) == 0)
+    {
+      grub_dprintf ("luks", "keyslot %d has invalid parameters\n", i);
+      return 0;
+    }
+
+  end = start + ((keysize * stripes + GRUB_DISK_SECTOR_SIZE - 1)
+		 >> GRUB_DISK_SECTOR_BITS);
+  if (start < ((sizeof (*header) + GRUB_DISK_SECTOR_SIZE - 1)
+	       >> GRUB_DISK_SECTOR_BITS)
+      || end > grub_be_to_cpu32 (header->payloadOffset))
+    {
+      grub_dprintf ("luks", "keyslot %d key material out of range\n", i);
+      return 0;
+    }
+
+  return 1;
+}
+
+static int
+parse_slot (const char *value)
+{
+  char *end;
+  unsigned long slot;
+
+  slot = grub_strtoul (value, &end, 10);
+  if (grub_errno || *end || slot >= LUKS_NUMKEYS)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return -1;
+    }
+  return slot;
+}
+
+/* The last key slots are only remembered if $luks_slot_cache is 1.  */
+static int
+slot_cache_enabled (void)
+{
+  const char *val;
+
+  val = grub_env_get ("luks_slot_cache");
+  return val && grub_strcmp (val, "1") == 0;
+}
+
+/* Helper for luks_get_last_slot.  */
+static int
+load_slot_var (const char *name, const char *value)
+{
+  if (grub_strncmp (name, LUKS_SLOT_VAR, sizeof (LUKS_SLOT_VAR) - 1) == 0
+      && ! grub_env_get (name))
+    grub_env_set (name, value);
+  return 0;
+}
+
+/* Return the key slot which last opened the volume, as recorded in
+   variable NAME, or -1 if none is recorded.  If NAME isn't in the
+   environment yet, the slot variables are imported from the environment
+   block under $prefix first.  */
+static int
+luks_get_last_slot (const char *name)
+{
+  const char *val;
+  const char *prefix;
+  char *filename;
+  grub_file_t file;
+  grub_envblk_t envblk = NULL;
+  grub_size_t size;
+  char *buf;
+
+  if (! slot_cache_enabled ())
+    return -1;
+
+  val = grub_env_get (name);
+  if (val)
+    return parse_slot (val);
+
+  /* The environment block is commonly on the encrypted volume itself,
+     so failing to read it is not an error.  */
+  prefix = grub_env_get ("prefix");
+  if (!prefix)
+    return -1;
+
+  filename = grub_xasprintf ("%s/" GRUB_ENVBLK_DEFCFG, prefix);
+  if (!filename)
+    goto out;
+  grub_file_filter_disable_compression ();
+  file = grub_file_open (filename);
+  grub_free (filename);
+  if (!file)
+    goto out;
+
+  size = grub_file_size (file);
+  buf = grub_malloc (size);
+  if (buf && grub_file_read (file, buf, size) == (grub_ssize_t) size)
+    envblk = grub_envblk_open (buf, size);
+  grub_file_close (file);
+  if (!envblk)
+    {
+      grub_free (buf);
+      goto out;
+    }
+
+  grub_envblk_iterate (envblk, load_slot_var);
+  grub_envblk_close (envblk);
+
+ out:
+  grub_errno = GRUB_ERR_NONE;
+  val = grub_env_get (name);
+  return val ? parse_slot (val) : -1;
+}
+
+/* Save the key slot of DEV in the environment block, once DEV is
+   unlocked.  The block is only rewritten in place through save_env, so it
+   is left alone on devices save_env refuses.  */
+static void
+luks_save_last_slot (grub_cryptodisk_t dev)
+{
+  char *argv[1];
+
+  argv[0] = grub_xasprintf (LUKS_SLOT_VAR "%s", dev->uuid);
+  if (argv[0])
+    {
+#ifndef GRUB_UTIL
+      if (! grub_command_find ("save_env"))
+	grub_dl_load ("loadenv");
+#endif
+      if (grub_command_find ("save_env"))
+	grub_command_execute ("save_env", 1, argv);
+      grub_free (argv[0]);
+    }
+  grub_errno = GRUB_ERR_NONE;
+}
+
+/* Record in variable NAME that SLOT opened DEV.  If the slot changed, the
+   environment block is updated once DEV is unlocked.  */
+static void
+luks_set_last_slot (grub_cryptodisk_t dev, const char *name, int slot,
+		    int last_slot)
+{
+  char buf[sizeof ("7")];
+
+  if (! slot_cache_enabled ())
+    return;
+
+  grub_snprintf (buf, sizeof (buf), "%d", slot);
+  if (grub_env_set (name, buf) == GRUB_ERR_NONE && slot != last_slot)
+    dev->unlocked = luks_save_last_slot;
+  grub_errno = GRUB_ERR_NONE;
+}
+
 static grub_err_t
 luks_recover_key (grub_disk_t source,
 		  grub_cryptodisk_t dev)
@@ -309,6 +480,11 @@ luks_recover_key (grub_disk_t source,
   grub_err_t err;
   grub_size_t max_stripes = 1;
   char *tmp;
+  char *slot_var;
+  unsigned order[LUKS_NUMKEYS];
+  unsigned nslots = 0;
+  unsigned k;
+  int last_slot;
 
   err = grub_disk_read (source, 0, 0, sizeof (header), &header);
   if (err)
@@ -317,14 +493,36 @@ luks_recover_key (grub_disk_t source,
   grub_puts_ (N_("Attempting to decrypt master key..."));
   keysize = grub_be_to_cpu32 (header.keyBytes);
 
+  if (grub_be_to_cpu32 (header.mkDigestIterations) == 0)
+    return grub_error (GRUB_ERR_BAD_FS, "invalid LUKS header");
+
+  slot_var = grub_xasprintf (LUKS_SLOT_VAR "%s", dev->uuid);
+  if (!slot_var)
+    return grub_errno;
+
+  /* Try the slot which opened the volume last time first, so that the
+     common case costs a single PBKDF2 run.  */
+  last_slot = luks_get_last_slot (slot_var);
+  if (last_slot >= 0 && luks_slot_usable (&header, last_slot))
+    order[nslots++] = last_slot;
+
   for (i = 0; i < ARRAY_SIZE (header.keyblock); i++)
-    if (grub_be_to_cpu32 (header.keyblock[i].active) == LUKS_KEY_ENABLED
-	&& grub_be_to_cpu32 (header.keyblock[i].stripes) > max_stripes)
-      max_stripes = grub_be_to_cpu32 (header.keyblock[i].stripes);
+    {
+      if ((int) i == last_slot || !luks_slot_usable (&header, i))
+	continue;
+      order[nslots++] = i;
+    }
+
+  for (k = 0; k < nslots; k++)
+    if (grub_be_to_cpu32 (header.keyblock[order[k]].stripes) > max_stripes)
+      max_stripes = grub_be_to_cpu32 (header.keyblock[order[k]].stripes);
 
   split_key = grub_malloc (keysize * max_stripes);
   if (!split_key)
-    return grub_errno;
+    {
+      grub_free (slot_var);
+      return grub_errno;
+    }
 
   /* Get the passphrase from the user.  */
   tmp = NULL;
@@ -337,20 +535,18 @@ luks_recover_key (grub_disk_t source,
   if (!grub_password_get (passphrase, MAX_PASSPHRASE))
     {
       grub_free (split_key);
+      grub_free (slot_var);
       return grub_error (GRUB_ERR_BAD_ARGUMENT, "Passphrase not supplied");
     }
 
-  /* Try to recover master key from each active keyslot.  */
-  for (i = 0; i < ARRAY_SIZE (header.keyblock); i++)
+  /* Try to recover master key from each usable keyslot.  */
+  for (k = 0; k < nslots; k++)
     {
       gcry_err_code_t gcry_err;
       grub_uint8_t candidate_key[keysize];
       grub_uint8_t digest[keysize];
 
-      /* Check if keyslot is enabled.  */
-      if (grub_be_to_cpu32 (header.keyblock[i].active) != LUKS_KEY_ENABLED)
-	continue;
-
+      i = order[k];
       grub_dprintf ("luks", "Trying keyslot %d\n", i);
 
       /* Calculate the PBKDF2 of the user supplied passphrase.  */
@@ -365,6 +561,7 @@ luks_recover_key (grub_disk_t source,
       if (gcry_err)
 	{
 	  grub_free (split_key);
+	  grub_free (slot_var);
 	  return grub_crypto_gcry_error (gcry_err);
 	}
 
@@ -374,6 +571,7 @@ luks_recover_key (grub_disk_t source,
       if (gcry_err)
 	{
 	  grub_free (split_key);
+	  grub_free (slot_var);
 	  return grub_crypto_gcry_error (gcry_err);
 	}
 
@@ -387,6 +585,7 @@ luks_recover_key (grub_disk_t source,
       if (err)
 	{
 	  grub_free (split_key);
+	  grub_free (slot_var);
 	  return err;
 	}
 
@@ -394,6 +593,7 @@ luks_recover_key (grub_disk_t source,
       if (gcry_err)
 	{
 	  grub_free (split_key);
+	  grub_free (slot_var);
 	  return grub_crypto_gcry_error (gcry_err);
 	}
 
@@ -403,6 +603,7 @@ luks_recover_key (grub_disk_t source,
       if (gcry_err)
 	{
 	  grub_free (split_key);
+	  grub_free (slot_var);
 	  return grub_crypto_gcry_error (gcry_err);
 	}
 
@@ -420,6 +621,7 @@ luks_recover_key (grub_disk_t source,
       if (gcry_err)
 	{
 	  grub_free (split_key);
+	  grub_free (slot_var);
 	  return grub_crypto_gcry_error (gcry_err);
 	}
 
@@ -441,14 +643,20 @@ luks_recover_key (grub_disk_t source,
       if (gcry_err)
 	{
 	  grub_free (split_key);
+	  grub_free (slot_var);
 	  return grub_crypto_gcry_error (gcry_err);
 	}
 
       grub_free (split_key);
 
+      luks_set_last_slot (dev, slot_var, i, last_slot);
+      grub_free (slot_var);
+
       return GRUB_ERR_NONE;
     }
 
+  grub_free (split_key);
+  grub_free (slot_var);
   return GRUB_ACCESS_DENIED;
 }
 
@@ -24,45 +24,10 @@
 #include <grub/misc.h>
 #include <grub/diskfilter.h>
 #include <grub/crypto.h>
+#include <grub/gf256.h>
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
-/* x**y.  */
-static grub_uint8_t powx[255 * 2];
-/* Such an s that x**s = y */
-static int powx_inv[256];
-static const grub_uint8_t poly = 0x1d;
-
-static void
-grub_raid_block_mulx (int mul, char *buf, int size)
-{
-  int i;
-  grub_uint8_t *p;
-
-  p = (grub_uint8_t *) buf;
-  for (i = 0; i < size; i++, p++)
-    if (*p)
-      *p = powx[mul + powx_inv[*p]];
-}
-
-static void
-grub_raid6_init_table (void)
-{
-  int i;
-
-  grub_uint8_t cur = 1;
-  for (i = 0; i < 255; i++)
-    {
-      powx[i] = cur;
-      powx[i + 255] = cur;
-      powx_inv[cur] = i;
-      if (cur & 0x80)
-	cur = (cur << 1) ^ poly;
-      else
-	cur <<= 1;
-    }
-}
-
 static grub_err_t
 grub_raid6_recover (struct grub_diskfilter_segment *array, int disknr, int p,
                     char *buf, grub_disk_addr_t sector, grub_size_t size)
@@ -103,8 +68,9 @@ grub_raid6_recover (struct grub_diskfilter_segment *array, int disknr, int p,
 					   size >> GRUB_DISK_SECTOR_BITS, buf))
             {
               grub_crypto_xor (pbuf, pbuf, buf, size);
-              grub_raid_block_mulx (c, buf, size);
-              grub_crypto_xor (qbuf, qbuf, buf, size);
+              grub_gf256_mul_xor_region ((grub_uint8_t *) qbuf,
+					 (grub_uint8_t *) buf, size,
+					 grub_gf256_powx[c]);
             }
           else
             {
@@ -142,8 +108,8 @@ grub_raid6_recover (struct grub_diskfilter_segment *array, int disknr, int p,
         goto quit;
 
       grub_crypto_xor (buf, buf, qbuf, size);
-      grub_raid_block_mulx (255 - bad1, buf,
-                           size);
+      grub_gf256_mul_region ((grub_uint8_t *) buf, (grub_uint8_t *) buf,
+			     size, grub_gf256_powx[255 - bad1]);
     }
   else
     {
@@ -162,11 +128,15 @@ grub_raid6_recover (struct grub_diskfilter_segment *array, int disknr, int p,
 
       grub_crypto_xor (qbuf, qbuf, buf, size);
 
-      c = (255 - bad1 + (255 - powx_inv[(powx[bad2 - bad1 + 255] ^ 1)])) % 255;
-      grub_raid_block_mulx (c, qbuf, size);
+      c = (255 - bad1
+	   + (255 - grub_gf256_powx_inv[(grub_gf256_powx[bad2 - bad1 + 255]
+					 ^ 1)])) % 255;
+      grub_gf256_mul_region ((grub_uint8_t *) qbuf, (grub_uint8_t *) qbuf,
+			     size, grub_gf256_powx[c]);
 
       c = (bad2 + c) % 255;
-      grub_raid_block_mulx (c, pbuf, size);
+      grub_gf256_mul_region ((grub_uint8_t *) pbuf, (grub_uint8_t *) pbuf,
+			     size, grub_gf256_powx[c]);
 
       grub_crypto_xor (pbuf, pbuf, qbuf, size);
       grub_memcpy (buf, pbuf, size);
@@ -181,7 +151,7 @@ quit:
 
 GRUB_MOD_INIT(raid6rec)
 {
-  grub_raid6_init_table ();
+  grub_gf256_init ();
   grub_raid6_recover_func = grub_raid6_recover;
 }
 
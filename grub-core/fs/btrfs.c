@@ -1733,6 +1733,12 @@ grub_btrfs_embed (grub_device_t device __attribute__ ((unused)),
 }
 #endif
 
+static const struct grub_fs_signature grub_btrfs_signatures[] =
+  {
+    GRUB_FS_SIGNATURE (65600, "_BHRfS_M"),
+    GRUB_FS_SIGNATURE_END
+  };
+
 static struct grub_fs grub_btrfs_fs = {
   .name = "btrfs",
   .dir = grub_btrfs_dir,
@@ -1740,6 +1746,7 @@ static struct grub_fs grub_btrfs_fs = {
   .read = grub_btrfs_read,
   .close = grub_btrfs_close,
   .uuid = grub_btrfs_uuid,
+  .signatures = grub_btrfs_signatures,
   .label = grub_btrfs_label,
 #ifdef GRUB_UTIL
   .embed = grub_btrfs_embed,
@@ -324,6 +324,13 @@ struct grub_ext2_data
   grub_disk_t disk;
   struct grub_ext2_inode *inode;
   struct grub_fshelp_node diropen;
+
+  /* Copy of the extent leaf last used for inode EXT_LEAF_INO. It maps the
+     file blocks EXT_LEAF_FIRST to EXT_LEAF_LAST.  */
+  grub_properly_aligned_t *ext_leaf;
+  int ext_leaf_ino;
+  grub_uint32_t ext_leaf_first;
+  grub_uint32_t ext_leaf_last;
 };
 
 static grub_dl_t my_mod;
@@ -343,13 +350,19 @@ grub_ext2_blockgroup (struct grub_ext2_data *data, int group,
 			 sizeof (struct grub_ext2_block_group), blkgrp);
 }
 
+/* Find the leaf holding FILEBLOCK and store the range of file blocks it
+   maps in *FIRST and *LAST.  */
 static struct grub_ext4_extent_header *
 grub_ext4_find_leaf (struct grub_ext2_data *data, grub_properly_aligned_t *buf,
                      struct grub_ext4_extent_header *ext_block,
-                     grub_uint32_t fileblock)
+                     grub_uint32_t fileblock, grub_uint32_t *first,
+                     grub_uint32_t *last)
 {
   struct grub_ext4_extent_idx *index;
 
+  *first = 0;
+  *last = 0xffffffff;
+
   while (1)
     {
       int i;
@@ -369,9 +382,14 @@ grub_ext4_find_leaf (struct grub_ext2_data *data, grub_properly_aligned_t *buf,
             break;
         }
 
+      if (i < grub_le_to_cpu16 (ext_block->entries))
+        *last = grub_le_to_cpu32 (index[i].block) - 1;
+
       if (--i < 0)
         return 0;
 
+      *first = grub_le_to_cpu32 (index[i].block);
+
       block = grub_le_to_cpu16 (index[i].leaf_hi);
       block = (block << 32) | grub_le_to_cpu32 (index[i].leaf);
       if (grub_disk_read (data->disk,
@@ -383,6 +401,88 @@ grub_ext4_find_leaf (struct grub_ext2_data *data, grub_properly_aligned_t *buf,
     }
 }
 
+/* Map the extent-mapped file block FILEBLOCK to the run of disk blocks
+   holding it.  */
+static grub_err_t
+grub_ext4_read_extent (grub_fshelp_node_t node, grub_disk_addr_t fileblock,
+		       grub_disk_addr_t *start, grub_disk_addr_t *len)
+{
+  struct grub_ext2_data *data = node->data;
+  GRUB_PROPERLY_ALIGNED_ARRAY (buf, EXT2_BLOCK_SIZE(data));
+  struct grub_ext4_extent_header *leaf;
+  struct grub_ext4_extent *ext;
+  grub_uint32_t extlen;
+  grub_disk_addr_t next;
+  grub_uint32_t first, last;
+  int i;
+
+  /* Sequential reads mostly stay within the leaf used last time.  */
+  if (data->ext_leaf && data->ext_leaf_ino == node->ino
+      && fileblock >= data->ext_leaf_first
+      && fileblock <= data->ext_leaf_last)
+    {
+      leaf = (struct grub_ext4_extent_header *) data->ext_leaf;
+      first = data->ext_leaf_first;
+      last = data->ext_leaf_last;
+    }
+  else
+    {
+      struct grub_ext4_extent_header *root;
+
+      root = (struct grub_ext4_extent_header *) node->inode.blocks.dir_blocks;
+      leaf = grub_ext4_find_leaf (data, buf, root, fileblock, &first, &last);
+      if (! leaf)
+	return grub_error (GRUB_ERR_BAD_FS, "invalid extent");
+
+      if (leaf != root)
+	{
+	  if (! data->ext_leaf)
+	    data->ext_leaf = grub_malloc (EXT2_BLOCK_SIZE (data));
+	  if (data->ext_leaf)
+	    {
+	      grub_memcpy (data->ext_leaf, buf, EXT2_BLOCK_SIZE (data));
+	      data->ext_leaf_ino = node->ino;
+	      data->ext_leaf_first = first;
+	      data->ext_leaf_last = last;
+	    }
+	  grub_errno = GRUB_ERR_NONE;
+	}
+    }
+
+  ext = (struct grub_ext4_extent *) (leaf + 1);
+  for (i = 0; i < grub_le_to_cpu16 (leaf->entries); i++)
+    {
+      if (fileblock < grub_le_to_cpu32 (ext[i].block))
+	break;
+    }
+
+  if (--i < 0)
+    return grub_error (GRUB_ERR_BAD_FS, "something wrong with extent");
+
+  /* Blocks up to the next extent, if known.  */
+  next = 0;
+  if (i + 1 < grub_le_to_cpu16 (leaf->entries))
+    next = grub_le_to_cpu32 (ext[i + 1].block) - fileblock;
+  else if (last != 0xffffffff)
+    next = (grub_disk_addr_t) last + 1 - fileblock;
+
+  fileblock -= grub_le_to_cpu32 (ext[i].block);
+  extlen = grub_le_to_cpu16 (ext[i].len);
+  if (fileblock >= extlen)
+    {
+      *start = 0;
+      *len = next ? : 1;
+      return GRUB_ERR_NONE;
+    }
+
+  *start = grub_le_to_cpu16 (ext[i].start_hi);
+  *start = (*start << 32) + grub_le_to_cpu32 (ext[i].start) + fileblock;
+  *len = extlen - fileblock;
+  if (next && *len > next)
+    *len = next;
+  return GRUB_ERR_NONE;
+}
+
 static grub_disk_addr_t
 grub_ext2_read_block (grub_fshelp_node_t node, grub_disk_addr_t fileblock)
 {
@@ -394,47 +494,11 @@ grub_ext2_read_block (grub_fshelp_node_t node, grub_disk_addr_t fileblock)
 
   if (inode->flags & grub_cpu_to_le32_compile_time (EXT4_EXTENTS_FLAG))
     {
-      GRUB_PROPERLY_ALIGNED_ARRAY (buf, EXT2_BLOCK_SIZE(data));
-      struct grub_ext4_extent_header *leaf;
-      struct grub_ext4_extent *ext;
-      int i;
+      grub_disk_addr_t start, len;
 
-      leaf = grub_ext4_find_leaf (data, buf,
-                                  (struct grub_ext4_extent_header *) inode->blocks.dir_blocks,
-                                  fileblock);
-      if (! leaf)
-        {
-          grub_error (GRUB_ERR_BAD_FS, "invalid extent");
-          return -1;
-        }
-
-      ext = (struct grub_ext4_extent *) (leaf + 1);
-      for (i = 0; i < grub_le_to_cpu16 (leaf->entries); i++)
-        {
-          if (fileblock < grub_le_to_cpu32 (ext[i].block))
-            break;
-        }
-
-      if (--i >= 0)
-        {
-          fileblock -= grub_le_to_cpu32 (ext[i].block);
-          if (fileblock >= grub_le_to_cpu16 (ext[i].len))
-            return 0;
-          else
-            {
-              grub_disk_addr_t start;
-
-              start = grub_le_to_cpu16 (ext[i].start_hi);
-              start = (start << 32) + grub_le_to_cpu32 (ext[i].start);
-
-              return fileblock + start;
-            }
-        }
-      else
-        {
-          grub_error (GRUB_ERR_BAD_FS, "something wrong with extent");
-          return -1;
-        }
+      if (grub_ext4_read_extent (node, fileblock, &start, &len))
+	return -1;
+      return start;
     }
   /* Direct blocks.  */
   if (fileblock < INDIRECT_BLOCKS)
@@ -528,6 +592,14 @@ grub_ext2_read_file (grub_fshelp_node_t node,
 		     grub_disk_read_hook_t read_hook, void *read_hook_data,
 		     grub_off_t pos, grub_size_t len, char *buf)
 {
+  if (node->inode.flags & grub_cpu_to_le32_compile_time (EXT4_EXTENTS_FLAG))
+    return grub_fshelp_read_file_extents (node->data->disk, node,
+					  read_hook, read_hook_data,
+					  pos, len, buf, grub_ext4_read_extent,
+					  grub_cpu_to_le32 (node->inode.size)
+					  | (((grub_off_t) grub_cpu_to_le32 (node->inode.size_high)) << 32),
+					  LOG2_EXT2_BLOCK_SIZE (node->data), 0);
+
   return grub_fshelp_read_file (node->data->disk, node,
 				read_hook, read_hook_data,
 				pos, len, buf, grub_ext2_read_block,
@@ -633,6 +705,7 @@ grub_ext2_mount (grub_disk_t disk)
   data->diropen.data = data;
   data->diropen.ino = 2;
   data->diropen.inode_read = 1;
+  data->ext_leaf = 0;
 
   data->inode = &data->diropen.inode;
 
@@ -815,6 +888,7 @@ grub_ext2_open (struct grub_file *file, const char *name)
     }
 
   grub_memcpy (data->inode, &fdiro->inode, sizeof (struct grub_ext2_inode));
+  data->diropen.ino = fdiro->ino;
   grub_free (fdiro);
 
   file->size = grub_le_to_cpu32 (data->inode->size);
@@ -827,6 +901,8 @@ grub_ext2_open (struct grub_file *file, const char *name)
  fail:
   if (fdiro != &data->diropen)
     grub_free (fdiro);
+  if (data)
+    grub_free (data->ext_leaf);
   grub_free (data);
 
   grub_dl_unref (my_mod);
@@ -837,7 +913,10 @@ grub_ext2_open (struct grub_file *file, const char *name)
 static grub_err_t
 grub_ext2_close (grub_file_t file)
 {
-  grub_free (file->data);
+  struct grub_ext2_data *data = file->data;
+
+  grub_free (data->ext_leaf);
+  grub_free (data);
 
   grub_dl_unref (my_mod);
 
@@ -918,6 +997,8 @@ grub_ext2_dir (grub_device_t device, const char *path, grub_fs_dir_hook_t hook,
  fail:
   if (fdiro != &ctx.data->diropen)
     grub_free (fdiro);
+  if (ctx.data)
+    grub_free (ctx.data->ext_leaf);
   grub_free (ctx.data);
 
   grub_dl_unref (my_mod);
@@ -1003,6 +1084,13 @@ grub_ext2_mtime (grub_device_t device, grub_int32_t *tm)
 
 
 
+/* The superblock magic, 0xEF53 little-endian.  */
+static const struct grub_fs_signature grub_ext2_signatures[] =
+  {
+    GRUB_FS_SIGNATURE (1080, "\x53\xef"),
+    GRUB_FS_SIGNATURE_END
+  };
+
 static struct grub_fs grub_ext2_fs =
   {
     .name = "ext2",
@@ -1013,6 +1101,7 @@ static struct grub_fs grub_ext2_fs =
     .label = grub_ext2_label,
     .uuid = grub_ext2_uuid,
     .mtime = grub_ext2_mtime,
+    .signatures = grub_ext2_signatures,
 #ifdef GRUB_UTIL
     .reserved_first_sector = 1,
     .blocklist_install = 1,
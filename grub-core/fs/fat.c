@@ -452,6 +452,55 @@ grub_fat_mount (grub_disk_t disk)
   return 0;
 }
 
+/* Read the FAT entry of CLUSTER into *NEXT.  */
+static grub_err_t
+grub_fat_get_next_cluster (grub_disk_t disk, struct grub_fat_data *data,
+			   grub_uint32_t cluster, grub_uint32_t *next)
+{
+  grub_uint32_t next_cluster;
+  unsigned long fat_offset;
+
+  switch (data->fat_size)
+    {
+    case 32:
+      fat_offset = cluster << 2;
+      break;
+    case 16:
+      fat_offset = cluster << 1;
+      break;
+    default:
+      /* case 12: */
+      fat_offset = cluster + (cluster >> 1);
+      break;
+    }
+
+  /* Read the FAT.  */
+  if (grub_disk_read (disk, data->fat_sector, fat_offset,
+		      (data->fat_size + 7) >> 3,
+		      (char *) &next_cluster))
+    return grub_errno;
+
+  next_cluster = grub_le_to_cpu32 (next_cluster);
+  switch (data->fat_size)
+    {
+    case 16:
+      next_cluster &= 0xFFFF;
+      break;
+    case 12:
+      if (cluster & 1)
+	next_cluster >>= 4;
+
+      next_cluster &= 0x0FFF;
+      break;
+    }
+
+  grub_dprintf ("fat", "fat_size=%d, next_cluster=%u\n",
+		data->fat_size, next_cluster);
+
+  *next = next_cluster;
+  return GRUB_ERR_NONE;
+}
+
 static grub_ssize_t
 grub_fat_read_data (grub_disk_t disk, struct grub_fat_data *data,
 		    grub_disk_read_hook_t read_hook, void *read_hook_data,
@@ -497,45 +546,11 @@ grub_fat_read_data (grub_disk_t disk, struct grub_fat_data *data,
 	{
 	  /* Find next cluster.  */
 	  grub_uint32_t next_cluster;
-	  unsigned long fat_offset;
 
-	  switch (data->fat_size)
-	    {
-	    case 32:
-	      fat_offset = data->cur_cluster << 2;
-	      break;
-	    case 16:
-	      fat_offset = data->cur_cluster << 1;
-	      break;
-	    default:
-	      /* case 12: */
-	      fat_offset = data->cur_cluster + (data->cur_cluster >> 1);
-	      break;
-	    }
-
-	  /* Read the FAT.  */
-	  if (grub_disk_read (disk, data->fat_sector, fat_offset,
-			      (data->fat_size + 7) >> 3,
-			      (char *) &next_cluster))
+	  if (grub_fat_get_next_cluster (disk, data, data->cur_cluster,
+					 &next_cluster))
 	    return -1;
 
-	  next_cluster = grub_le_to_cpu32 (next_cluster);
-	  switch (data->fat_size)
-	    {
-	    case 16:
-	      next_cluster &= 0xFFFF;
-	      break;
-	    case 12:
-	      if (data->cur_cluster & 1)
-		next_cluster >>= 4;
-
-	      next_cluster &= 0x0FFF;
-	      break;
-	    }
-
-	  grub_dprintf ("fat", "fat_size=%d, next_cluster=%u\n",
-			data->fat_size, next_cluster);
-
 	  /* Check the end.  */
 	  if (next_cluster >= data->cluster_eof_mark)
 	    return ret;
@@ -556,6 +571,26 @@ grub_fat_read_data (grub_disk_t disk, struct grub_fat_data *data,
 		+ ((data->cur_cluster - 2)
 		   << data->cluster_bits));
       size = (1 << logical_cluster_bits) - offset;
+
+      /* Read the following clusters with the same request as long as
+	 they are contiguous.  */
+      while (size < len)
+	{
+	  grub_uint32_t next_cluster;
+
+	  if (grub_fat_get_next_cluster (disk, data, data->cur_cluster,
+					 &next_cluster))
+	    return -1;
+	  if (next_cluster != data->cur_cluster + 1
+	      || next_cluster >= data->num_clusters)
+	    break;
+
+	  data->cur_cluster = next_cluster;
+	  data->cur_cluster_num++;
+	  logical_cluster++;
+	  size += 1 << logical_cluster_bits;
+	}
+
       if (size > len)
 	size = len;
 
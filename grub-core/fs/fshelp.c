@@ -246,61 +246,79 @@ grub_fshelp_find_file (const char *path, grub_fshelp_node_t rootnode,
   return 0;
 }
 
-/* Read LEN bytes from the file NODE on disk DISK into the buffer BUF,
-   beginning with the block POS.  READ_HOOK should be set before
-   reading a block from the file.  READ_HOOK_DATA is passed through as
-   the DATA argument to READ_HOOK.  GET_BLOCK is used to translate
-   file blocks to disk blocks.  The file is FILESIZE bytes big and the
-   blocks have a size of LOG2BLOCKSIZE (in log2).  */
-grub_ssize_t
-grub_fshelp_read_file (grub_disk_t disk, grub_fshelp_node_t node,
+static grub_ssize_t
+grub_fshelp_read_runs (grub_disk_t disk, grub_fshelp_node_t node,
 		       grub_disk_read_hook_t read_hook, void *read_hook_data,
 		       grub_off_t pos, grub_size_t len, char *buf,
 		       grub_disk_addr_t (*get_block) (grub_fshelp_node_t node,
-                                                      grub_disk_addr_t block),
+						      grub_disk_addr_t block),
+		       grub_fshelp_get_extent_t get_extent,
 		       grub_off_t filesize, int log2blocksize,
 		       grub_disk_addr_t blocks_start)
 {
   grub_disk_addr_t i, blockcnt;
-  int blocksize = 1 << (log2blocksize + GRUB_DISK_SECTOR_BITS);
+  grub_disk_addr_t next_blknr = 0;
+  int have_next = 0;
+  int log2bytes = log2blocksize + GRUB_DISK_SECTOR_BITS;
 
   /* Adjust LEN so it we can't read past the end of the file.  */
   if (pos + len > filesize)
     len = filesize - pos;
 
-  blockcnt = ((len + pos) + blocksize - 1) >> (log2blocksize + GRUB_DISK_SECTOR_BITS);
+  blockcnt = ((len + pos) + (1 << log2bytes) - 1) >> log2bytes;
 
-  for (i = pos >> (log2blocksize + GRUB_DISK_SECTOR_BITS); i < blockcnt; i++)
+  i = pos >> log2bytes;
+  while (i < blockcnt)
     {
-      grub_disk_addr_t blknr;
-      int blockoff = pos & (blocksize - 1);
-      int blockend = blocksize;
-
-      int skipfirst = 0;
-
-      blknr = get_block (node, i);
-      if (grub_errno)
-	return -1;
-
-      blknr = blknr << log2blocksize;
+      grub_disk_addr_t blknr, run = 1;
+      grub_off_t run_start, run_end;
+      grub_size_t skipfirst = 0, runlen;
 
-      /* Last block.  */
-      if (i == blockcnt - 1)
+      if (get_extent)
 	{
-	  blockend = (len + pos) & (blocksize - 1);
-
-	  /* The last portion is exactly blocksize.  */
-	  if (! blockend)
-	    blockend = blocksize;
+	  if (get_extent (node, i, &blknr, &run))
+	    return -1;
+	  if (run == 0)
+	    run = 1;
+	  if (run > blockcnt - i)
+	    run = blockcnt - i;
 	}
-
-      /* First block.  */
-      if (i == (pos >> (log2blocksize + GRUB_DISK_SECTOR_BITS)))
+      else
 	{
-	  skipfirst = blockoff;
-	  blockend -= skipfirst;
+	  if (have_next)
+	    blknr = next_blknr;
+	  else
+	    {
+	      blknr = get_block (node, i);
+	      if (grub_errno)
+		return -1;
+	    }
+	  have_next = 0;
+
+	  /* Merge the following blocks as long as they are contiguous on
+	     disk, or are all sparse.  */
+	  while (i + run < blockcnt)
+	    {
+	      next_blknr = get_block (node, i + run);
+	      if (grub_errno)
+		return -1;
+	      if (next_blknr != (blknr ? blknr + run : 0))
+		{
+		  have_next = 1;
+		  break;
+		}
+	      run++;
+	    }
 	}
 
+      run_start = i << log2bytes;
+      run_end = (i + run) << log2bytes;
+      if (run_start < pos)
+	skipfirst = pos - run_start;
+      if (run_end > pos + len)
+	run_end = pos + len;
+      runlen = run_end - run_start - skipfirst;
+
       /* If the block number is 0 this block is not stored on disk but
 	 is zero filled instead.  */
       if (blknr)
@@ -308,17 +326,55 @@ grub_fshelp_read_file (grub_disk_t disk, grub_fshelp_node_t node,
 	  disk->read_hook = read_hook;
 	  disk->read_hook_data = read_hook_data;
 
-	  grub_disk_read (disk, blknr + blocks_start, skipfirst,
-			  blockend, buf);
+	  grub_disk_read (disk, (blknr << log2blocksize) + blocks_start,
+			  skipfirst, runlen, buf);
 	  disk->read_hook = 0;
 	  if (grub_errno)
 	    return -1;
 	}
       else
-	grub_memset (buf, 0, blockend);
+	grub_memset (buf, 0, runlen);
 
-      buf += blocksize - skipfirst;
+      buf += runlen;
+      i += run;
     }
 
   return len;
 }
+
+/* Read LEN bytes from the file NODE on disk DISK into the buffer BUF,
+   beginning with the block POS.  READ_HOOK should be set before
+   reading a block from the file.  READ_HOOK_DATA is passed through as
+   the DATA argument to READ_HOOK.  GET_BLOCK is used to translate
+   file blocks to disk blocks.  The file is FILESIZE bytes big and the
+   blocks have a size of LOG2BLOCKSIZE (in log2).  Blocks which are
+   contiguous on disk are read with a single request.  */
+grub_ssize_t
+grub_fshelp_read_file (grub_disk_t disk, grub_fshelp_node_t node,
+		       grub_disk_read_hook_t read_hook, void *read_hook_data,
+		       grub_off_t pos, grub_size_t len, char *buf,
+		       grub_disk_addr_t (*get_block) (grub_fshelp_node_t node,
+                                                      grub_disk_addr_t block),
+		       grub_off_t filesize, int log2blocksize,
+		       grub_disk_addr_t blocks_start)
+{
+  return grub_fshelp_read_runs (disk, node, read_hook, read_hook_data,
+				pos, len, buf, get_block, 0, filesize,
+				log2blocksize, blocks_start);
+}
+
+/* Like grub_fshelp_read_file, but translate file blocks with GET_EXTENT,
+   which maps a whole run of blocks at once.  */
+grub_ssize_t
+grub_fshelp_read_file_extents (grub_disk_t disk, grub_fshelp_node_t node,
+			       grub_disk_read_hook_t read_hook,
+			       void *read_hook_data,
+			       grub_off_t pos, grub_size_t len, char *buf,
+			       grub_fshelp_get_extent_t get_extent,
+			       grub_off_t filesize, int log2blocksize,
+			       grub_disk_addr_t blocks_start)
+{
+  return grub_fshelp_read_runs (disk, node, read_hook, read_hook_data,
+				pos, len, buf, 0, get_extent, filesize,
+				log2blocksize, blocks_start);
+}
@@ -1399,6 +1399,12 @@ grub_hfs_uuid (grub_device_t device, char **uuid)
 
 
 
+static const struct grub_fs_signature grub_hfs_signatures[] =
+  {
+    GRUB_FS_SIGNATURE (1024, "BD"),
+    GRUB_FS_SIGNATURE_END
+  };
+
 static struct grub_fs grub_hfs_fs =
   {
     .name = "hfs",
@@ -1409,6 +1415,7 @@ static struct grub_fs grub_hfs_fs =
     .label = grub_hfs_label,
     .uuid = grub_hfs_uuid,
     .mtime = grub_hfs_mtime,
+    .signatures = grub_hfs_signatures,
 #ifdef GRUB_UTIL
     .reserved_first_sector = 1,
     .blocklist_install = 1,
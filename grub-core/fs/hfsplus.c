@@ -1064,6 +1064,15 @@ grub_hfsplus_uuid (grub_device_t device, char **uuid)
 
 
 
+/* HFS+, HFSX, or an HFS wrapper around HFS+.  */
+static const struct grub_fs_signature grub_hfsplus_signatures[] =
+  {
+    GRUB_FS_SIGNATURE (1024, "H+"),
+    GRUB_FS_SIGNATURE (1024, "HX"),
+    GRUB_FS_SIGNATURE (1024, "BD"),
+    GRUB_FS_SIGNATURE_END
+  };
+
 static struct grub_fs grub_hfsplus_fs =
   {
     .name = "hfsplus",
@@ -1073,6 +1082,7 @@ static struct grub_fs grub_hfsplus_fs =
     .close = grub_hfsplus_close,
     .label = grub_hfsplus_label,
     .mtime = grub_hfsplus_mtime,
+    .signatures = grub_hfsplus_signatures,
     .uuid = grub_hfsplus_uuid,
 #ifdef GRUB_UTIL
     .reserved_first_sector = 1,
@@ -1099,6 +1099,13 @@ grub_iso9660_mtime (grub_device_t device, grub_int32_t *timebuf)
 
 
 
+/* The first volume descriptor, at block 16.  */
+static const struct grub_fs_signature grub_iso9660_signatures[] =
+  {
+    GRUB_FS_SIGNATURE (32769, "CD001"),
+    GRUB_FS_SIGNATURE_END
+  };
+
 static struct grub_fs grub_iso9660_fs =
   {
     .name = "iso9660",
@@ -1109,6 +1116,7 @@ static struct grub_fs grub_iso9660_fs =
     .label = grub_iso9660_label,
     .uuid = grub_iso9660_uuid,
     .mtime = grub_iso9660_mtime,
+    .signatures = grub_iso9660_signatures,
 #ifdef GRUB_UTIL
     .reserved_first_sector = 1,
     .blocklist_install = 1,
@@ -1246,6 +1246,12 @@ grub_ntfs_uuid (grub_device_t device, char **uuid)
   return grub_errno;
 }
 
+static const struct grub_fs_signature grub_ntfs_signatures[] =
+  {
+    GRUB_FS_SIGNATURE (3, "NTFS"),
+    GRUB_FS_SIGNATURE_END
+  };
+
 static struct grub_fs grub_ntfs_fs =
   {
     .name = "ntfs",
@@ -1255,6 +1261,7 @@ static struct grub_fs grub_ntfs_fs =
     .close = grub_ntfs_close,
     .label = grub_ntfs_label,
     .uuid = grub_ntfs_uuid,
+    .signatures = grub_ntfs_signatures,
 #ifdef GRUB_UTIL
     .reserved_first_sector = 1,
     .blocklist_install = 1,
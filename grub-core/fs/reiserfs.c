@@ -1378,6 +1378,13 @@ grub_reiserfs_uuid (grub_device_t device, char **uuid)
   return grub_errno;
 }
 
+/* Any version of the magic string.  */
+static const struct grub_fs_signature grub_reiserfs_signatures[] =
+  {
+    GRUB_FS_SIGNATURE (65588, "ReIsEr"),
+    GRUB_FS_SIGNATURE_END
+  };
+
 static struct grub_fs grub_reiserfs_fs =
   {
     .name = "reiserfs",
@@ -1387,6 +1394,7 @@ static struct grub_fs grub_reiserfs_fs =
     .close = grub_reiserfs_close,
     .label = grub_reiserfs_label,
     .uuid = grub_reiserfs_uuid,
+    .signatures = grub_reiserfs_signatures,
 #ifdef GRUB_UTIL
     .reserved_first_sector = 1,
     .blocklist_install = 1,
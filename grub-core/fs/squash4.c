@@ -975,6 +975,12 @@ grub_squash_mtime (grub_device_t dev, grub_int32_t *tm)
   return GRUB_ERR_NONE;
 } 
 
+static const struct grub_fs_signature grub_squash_signatures[] =
+  {
+    GRUB_FS_SIGNATURE (0, "hsqs"),
+    GRUB_FS_SIGNATURE_END
+  };
+
 static struct grub_fs grub_squash_fs =
   {
     .name = "squash4",
@@ -983,6 +989,7 @@ static struct grub_fs grub_squash_fs =
     .read = grub_squash_read,
     .close = grub_squash_close,
     .mtime = grub_squash_mtime,
+    .signatures = grub_squash_signatures,
 #ifdef GRUB_UTIL
     .reserved_first_sector = 0,
     .blocklist_install = 0,
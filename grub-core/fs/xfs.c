@@ -275,13 +275,18 @@ grub_xfs_read_inode (struct grub_xfs_data *data, grub_uint64_t ino,
 }
 
 
-static grub_disk_addr_t
-grub_xfs_read_block (grub_fshelp_node_t node, grub_disk_addr_t fileblock)
+/* Map FILEBLOCK to the run of filesystem blocks holding it.  */
+static grub_err_t
+grub_xfs_read_extent (grub_fshelp_node_t node, grub_disk_addr_t fileblock,
+		      grub_disk_addr_t *start, grub_disk_addr_t *len)
 {
   struct grub_xfs_btree_node *leaf = 0;
   int ex, nrec;
   grub_xfs_extent *exts;
-  grub_uint64_t ret = 0;
+
+  /* Sparse until proven otherwise.  */
+  *start = 0;
+  *len = 1;
 
   if (node->inode.format == XFS_INODE_FORMAT_BTREE)
     {
@@ -290,7 +295,7 @@ grub_xfs_read_block (grub_fshelp_node_t node, grub_disk_addr_t fileblock)
 
       leaf = grub_malloc (node->data->bsize);
       if (leaf == 0)
-        return 0;
+        return grub_errno;
 
       nrec = grub_be_to_cpu16 (node->inode.data.btree.numrecs);
       keys = &node->inode.data.btree.keys[0];
@@ -315,18 +320,20 @@ grub_xfs_read_block (grub_fshelp_node_t node, grub_disk_addr_t fileblock)
           if (i == 0)
             {
               grub_free (leaf);
-              return 0;
+              return GRUB_ERR_NONE;
             }
           if (grub_disk_read (node->data->disk,
                               GRUB_XFS_FSB_TO_BLOCK (node->data, grub_be_to_cpu64 (keys[i - 1 + recoffset])) << (node->data->sblock.log2_bsize - GRUB_DISK_SECTOR_BITS),
                               0, node->data->bsize, leaf))
-            return 0;
+            {
+              grub_free (leaf);
+              return grub_errno;
+            }
 
           if (grub_strncmp ((char *) leaf->magic, "BMAP", 4))
             {
               grub_free (leaf);
-              grub_error (GRUB_ERR_BAD_FS, "not a correct XFS BMAP node");
-              return 0;
+              return grub_error (GRUB_ERR_BAD_FS, "not a correct XFS BMAP node");
             }
 
           nrec = grub_be_to_cpu16 (leaf->numrecs);
@@ -345,33 +352,39 @@ grub_xfs_read_block (grub_fshelp_node_t node, grub_disk_addr_t fileblock)
     }
   else
     {
-      grub_error (GRUB_ERR_NOT_IMPLEMENTED_YET,
-		  "XFS does not support inode format %d yet",
-		  node->inode.format);
-      return 0;
+      return grub_error (GRUB_ERR_NOT_IMPLEMENTED_YET,
+			 "XFS does not support inode format %d yet",
+			 node->inode.format);
     }
 
   /* Iterate over each extent to figure out which extent has
      the block we are looking for.  */
   for (ex = 0; ex < nrec; ex++)
     {
-      grub_uint64_t start = GRUB_XFS_EXTENT_BLOCK (exts, ex);
+      grub_uint64_t ext_start = GRUB_XFS_EXTENT_BLOCK (exts, ex);
       grub_uint64_t offset = GRUB_XFS_EXTENT_OFFSET (exts, ex);
       grub_uint64_t size = GRUB_XFS_EXTENT_SIZE (exts, ex);
 
       /* Sparse block.  */
       if (fileblock < offset)
-        break;
+	{
+	  *len = offset - fileblock;
+	  break;
+	}
       else if (fileblock < offset + size)
         {
-          ret = (fileblock - offset + start);
+	  /* An extent never crosses an allocation group, so it is
+	     contiguous on disk as well.  */
+          *start = GRUB_XFS_FSB_TO_BLOCK (node->data,
+					  fileblock - offset + ext_start);
+	  *len = offset + size - fileblock;
           break;
         }
     }
 
   grub_free (leaf);
 
-  return GRUB_XFS_FSB_TO_BLOCK(node->data, ret);
+  return GRUB_ERR_NONE;
 }
 
 
@@ -382,12 +395,12 @@ grub_xfs_read_file (grub_fshelp_node_t node,
 		     grub_disk_read_hook_t read_hook, void *read_hook_data,
 		     grub_off_t pos, grub_size_t len, char *buf)
 {
-  return grub_fshelp_read_file (node->data->disk, node,
-				read_hook, read_hook_data,
-				pos, len, buf, grub_xfs_read_block,
-				grub_be_to_cpu64 (node->inode.size),
-				node->data->sblock.log2_bsize
-				- GRUB_DISK_SECTOR_BITS, 0);
+  return grub_fshelp_read_file_extents (node->data->disk, node,
+					read_hook, read_hook_data,
+					pos, len, buf, grub_xfs_read_extent,
+					grub_be_to_cpu64 (node->inode.size),
+					node->data->sblock.log2_bsize
+					- GRUB_DISK_SECTOR_BITS, 0);
 }
 
 
@@ -900,6 +913,12 @@ grub_xfs_uuid (grub_device_t device, char **uuid)
 
 
 
+static const struct grub_fs_signature grub_xfs_signatures[] =
+  {
+    GRUB_FS_SIGNATURE (0, "XFSB"),
+    GRUB_FS_SIGNATURE_END
+  };
+
 static struct grub_fs grub_xfs_fs =
   {
     .name = "xfs",
@@ -909,6 +928,7 @@ static struct grub_fs grub_xfs_fs =
     .close = grub_xfs_close,
     .label = grub_xfs_label,
     .uuid = grub_xfs_uuid,
+    .signatures = grub_xfs_signatures,
 #ifdef GRUB_UTIL
     .reserved_first_sector = 0,
     .blocklist_install = 1,
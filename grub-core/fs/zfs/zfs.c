@@ -54,6 +54,7 @@
 #include <grub/zfs/dsl_dataset.h>
 #include <grub/deflate.h>
 #include <grub/crypto.h>
+#include <grub/gf256.h>
 #include <grub/i18n.h>
 
 GRUB_MOD_LICENSE ("GPLv3+");
@@ -1244,12 +1245,6 @@ scan_devices (struct grub_zfs_data *data)
   return GRUB_ERR_NONE;
 }
 
-/* x**y.  */
-static grub_uint8_t powx[255 * 2];
-/* Such an s that x**s = y */
-static int powx_inv[256];
-static const grub_uint8_t poly = 0x1d;
-
 /* perform the operation a ^= b * (x ** (known_idx * recovery_pow) ) */
 static inline void
 xor_out (grub_uint8_t *a, const grub_uint8_t *b, grub_size_t s,
@@ -1264,17 +1259,7 @@ xor_out (grub_uint8_t *a, const grub_uint8_t *b, grub_size_t s,
       return;
     }
   add = (known_idx * recovery_pow) % 255;
-  for (;s--; b++, a++)
-    if (*b)
-      *a ^= powx[powx_inv[*b] + add];
-}
-
-static inline grub_uint8_t
-gf_mul (grub_uint8_t a, grub_uint8_t b)
-{
-  if (a == 0 || b == 0)
-    return 0;
-  return powx[powx_inv[a] + powx_inv[b]];
+  grub_gf256_mul_xor_region (a, b, s, grub_gf256_powx[add]);
 }
 
 static inline grub_err_t
@@ -1292,13 +1277,10 @@ recovery (grub_uint8_t *bufs[4], grub_size_t s, const int nbufs,
     case 1:
       {
 	int add;
-	grub_uint8_t *a;
 	if (powers[0] == 0 || idx[0] == 0)
 	  return GRUB_ERR_NONE;
 	add = 255 - ((powers[0] * idx[0]) % 255);
-	for (a = bufs[0]; s--; a++)
-	  if (*a)
-	    *a = powx[powx_inv[*a] + add];
+	grub_gf256_mul_region (bufs[0], bufs[0], s, grub_gf256_powx[add]);
 	return GRUB_ERR_NONE;
       }
       /* Case 2x2: Let's use the determinant formula.  */
@@ -1306,39 +1288,43 @@ recovery (grub_uint8_t *bufs[4], grub_size_t s, const int nbufs,
       {
 	grub_uint8_t det, det_inv;
 	grub_uint8_t matrixinv[2][2];
-	unsigned i;
+	grub_uint8_t *tmp;
 	/* The determinant is: */
-	det = (powx[(powers[0] * idx[0] + powers[1] * idx[1]) % 255]
-	       ^ powx[(powers[0] * idx[1] + powers[1] * idx[0]) % 255]);
+	det = (grub_gf256_powx[(powers[0] * idx[0] + powers[1] * idx[1]) % 255]
+	       ^ grub_gf256_powx[(powers[0] * idx[1]
+				  + powers[1] * idx[0]) % 255]);
 	if (det == 0)
 	  return grub_error (GRUB_ERR_BAD_FS, "singular recovery matrix");
-	det_inv = powx[255 - powx_inv[det]];
-	matrixinv[0][0] = gf_mul (powx[(powers[1] * idx[1]) % 255], det_inv);
-	matrixinv[1][1] = gf_mul (powx[(powers[0] * idx[0]) % 255], det_inv);
-	matrixinv[0][1] = gf_mul (powx[(powers[0] * idx[1]) % 255], det_inv);
-	matrixinv[1][0] = gf_mul (powx[(powers[1] * idx[0]) % 255], det_inv);
-	for (i = 0; i < s; i++)
-	  {
-	    grub_uint8_t b0, b1;
-	    b0 = bufs[0][i];
-	    b1 = bufs[1][i];
-
-	    bufs[0][i] = (gf_mul (b0, matrixinv[0][0])
-			  ^ gf_mul (b1, matrixinv[0][1]));
-	    bufs[1][i] = (gf_mul (b0, matrixinv[1][0])
-			  ^ gf_mul (b1, matrixinv[1][1]));
-	  }
+	det_inv = grub_gf256_powx[255 - grub_gf256_powx_inv[det]];
+	matrixinv[0][0] = grub_gf256_mul (grub_gf256_powx[(powers[1] * idx[1])
+							  % 255], det_inv);
+	matrixinv[1][1] = grub_gf256_mul (grub_gf256_powx[(powers[0] * idx[0])
+							  % 255], det_inv);
+	matrixinv[0][1] = grub_gf256_mul (grub_gf256_powx[(powers[0] * idx[1])
+							  % 255], det_inv);
+	matrixinv[1][0] = grub_gf256_mul (grub_gf256_powx[(powers[1] * idx[0])
+							  % 255], det_inv);
+	tmp = grub_malloc (s);
+	if (!tmp)
+	  return grub_errno;
+	grub_gf256_mul_region (tmp, bufs[0], s, matrixinv[0][0]);
+	grub_gf256_mul_xor_region (tmp, bufs[1], s, matrixinv[0][1]);
+	grub_gf256_mul_region (bufs[1], bufs[1], s, matrixinv[1][1]);
+	grub_gf256_mul_xor_region (bufs[1], bufs[0], s, matrixinv[1][0]);
+	grub_memcpy (bufs[0], tmp, s);
+	grub_free (tmp);
 	return GRUB_ERR_NONE;
       }
       /* Otherwise use Gauss.  */
     default:
       {
 	grub_uint8_t matrix1[nbufs][nbufs], matrix2[nbufs][nbufs];
+	grub_uint8_t *tmp;
 	int i, j, k;
 
 	for (i = 0; i < nbufs; i++)
 	  for (j = 0; j < nbufs; j++)
-	    matrix1[i][j] = powx[(powers[i] * idx[j]) % 255];
+	    matrix1[i][j] = grub_gf256_powx[(powers[i] * idx[j]) % 255];
 	for (i = 0; i < nbufs; i++)
 	  for (j = 0; j < nbufs; j++)
 	    matrix2[i][j] = 0;
@@ -1372,18 +1358,18 @@ recovery (grub_uint8_t *bufs[4], grub_size_t s, const int nbufs,
 		    matrix2[i][j] = t;
 		  }
 	      }
-	    mul = powx[255 - powx_inv[matrix1[i][i]]];
+	    mul = grub_gf256_powx[255 - grub_gf256_powx_inv[matrix1[i][i]]];
 	    for (j = 0; j < nbufs; j++)
-	      matrix1[i][j] = gf_mul (matrix1[i][j], mul);
+	      matrix1[i][j] = grub_gf256_mul (matrix1[i][j], mul);
 	    for (j = 0; j < nbufs; j++)
-	      matrix2[i][j] = gf_mul (matrix2[i][j], mul);
+	      matrix2[i][j] = grub_gf256_mul (matrix2[i][j], mul);
 	    for (j = i + 1; j < nbufs; j++)
 	      {
 		mul = matrix1[j][i];
 		for (k = 0; k < nbufs; k++)
-		  matrix1[j][k] ^= gf_mul (matrix1[i][k], mul);
+		  matrix1[j][k] ^= grub_gf256_mul (matrix1[i][k], mul);
 		for (k = 0; k < nbufs; k++)
-		  matrix2[j][k] ^= gf_mul (matrix2[i][k], mul);
+		  matrix2[j][k] ^= grub_gf256_mul (matrix2[i][k], mul);
 	      }
 	  }
 	for (i = nbufs - 1; i >= 0; i--)
@@ -1393,24 +1379,26 @@ recovery (grub_uint8_t *bufs[4], grub_size_t s, const int nbufs,
 		grub_uint8_t mul;
 		mul = matrix1[j][i];
 		for (k = 0; k < nbufs; k++)
-		  matrix1[j][k] ^= gf_mul (matrix1[i][k], mul);
+		  matrix1[j][k] ^= grub_gf256_mul (matrix1[i][k], mul);
 		for (k = 0; k < nbufs; k++)
-		  matrix2[j][k] ^= gf_mul (matrix2[i][k], mul);
+		  matrix2[j][k] ^= grub_gf256_mul (matrix2[i][k], mul);
 	      }
 	  }
 
-	for (i = 0; i < (int) s; i++)
+	/* Multiply the whole buffers by the inverse, one row at a time.  */
+	tmp = grub_malloc (nbufs * s);
+	if (!tmp)
+	  return grub_errno;
+	for (j = 0; j < nbufs; j++)
 	  {
-	    grub_uint8_t b[nbufs];
-	    for (j = 0; j < nbufs; j++)
-	      b[j] = bufs[j][i];
-	    for (j = 0; j < nbufs; j++)
-	      {
-		bufs[j][i] = 0;
-		for (k = 0; k < nbufs; k++)
-		  bufs[j][i] ^= gf_mul (matrix2[j][k], b[k]);
-	      }
+	    grub_gf256_mul_region (tmp + j * s, bufs[0], s, matrix2[j][0]);
+	    for (k = 1; k < nbufs; k++)
+	      grub_gf256_mul_xor_region (tmp + j * s, bufs[k], s,
+					 matrix2[j][k]);
 	  }
+	for (j = 0; j < nbufs; j++)
+	  grub_memcpy (bufs[j], tmp + j * s, s);
+	grub_free (tmp);
 	return GRUB_ERR_NONE;
       }
     }      
@@ -1542,21 +1530,7 @@ read_device (grub_uint64_t offset, struct grub_zfs_device_desc *desc,
 	    unsigned i, j;
 	    grub_err_t err;
 
-	    /* Compute mul. x**s has a period of 255.  */
-	    if (powx[0] == 0)
-	      {
-		grub_uint8_t cur = 1;
-		for (i = 0; i < 255; i++)
-		  {
-		    powx[i] = cur;
-		    powx[i + 255] = cur;
-		    powx_inv[cur] = i;
-		    if (cur & 0x80)
-		      cur = (cur << 1) ^ poly;
-		    else
-		      cur <<= 1;
-		  }
-	      }
+	    grub_gf256_init ();
 
 	    /* Read redundancy data.  */
 	    for (n_redundancy = 0, cur_redundancy_pow = 0;
@@ -38,12 +38,6 @@ static struct grub_gettext_context main_context, secondary_context;
 
 static const char *(*grub_gettext_original) (const char *s);
 
-struct grub_gettext_msg
-{
-  char *name;
-  char *translated;
-};
-
 struct header
 {
   grub_uint32_t magic;
@@ -51,6 +45,8 @@ struct header
   grub_uint32_t number_of_strings;
   grub_uint32_t offset_original;
   grub_uint32_t offset_translation;
+  grub_uint32_t hash_size;
+  grub_uint32_t offset_hash;
 };
 
 struct string_descriptor 
@@ -59,14 +55,20 @@ struct string_descriptor
   grub_uint32_t offset;
 };
 
+/* The whole .mo file is kept in memory: it's read once when the language
+   is selected.  Translations are copied out of it when first looked up,
+   so that it can be freed when the language changes.  */
 struct grub_gettext_context
 {
-  grub_file_t fd_mo;
-  grub_off_t grub_gettext_offset_original;
-  grub_off_t grub_gettext_offset_translation;
+  char *mo_data;
+  grub_size_t mo_size;
+  char **translations;
+  grub_size_t grub_gettext_offset_original;
+  grub_size_t grub_gettext_offset_translation;
   grub_size_t grub_gettext_max;
   int grub_gettext_max_log;
-  struct grub_gettext_msg *grub_gettext_msg_list;
+  grub_size_t grub_gettext_offset_hash;
+  grub_uint32_t grub_gettext_hash_size;
 };
 
 #define MO_MAGIC_NUMBER 		0x950412de
@@ -88,64 +90,120 @@ grub_gettext_pread (grub_file_t file, void *buf, grub_size_t len,
   return GRUB_ERR_NONE;
 }
 
-static char *
+static inline grub_uint32_t
+grub_gettext_get32 (struct grub_gettext_context *ctx, grub_size_t offset)
+{
+  return grub_le_to_cpu32 (grub_get_unaligned32 (ctx->mo_data + offset));
+}
+
+static const char *
 grub_gettext_getstr_from_position (struct grub_gettext_context *ctx,
-				   grub_off_t off,
+				   grub_size_t off,
 				   grub_size_t position)
 {
-  grub_off_t internal_position;
-  grub_size_t length;
-  grub_off_t offset;
-  char *translation;
-  struct string_descriptor desc;
-  grub_err_t err;
-
-  internal_position = (off + position * sizeof (desc));
+  grub_size_t internal_position;
+  grub_uint32_t length;
+  grub_uint32_t offset;
 
-  err = grub_gettext_pread (ctx->fd_mo, (char *) &desc,
-			    sizeof (desc), internal_position);
-  if (err)
-    return NULL;
-  length = grub_cpu_to_le32 (desc.length);
-  offset = grub_cpu_to_le32 (desc.offset);
+  internal_position = off + position * sizeof (struct string_descriptor);
+  length = grub_gettext_get32 (ctx, internal_position);
+  offset = grub_gettext_get32 (ctx, internal_position + sizeof (length));
 
-  translation = grub_malloc (length + 1);
-  if (!translation)
+  /* Strings are NUL-terminated in the file, which lets them be used in
+     place.  */
+  if (offset >= ctx->mo_size || length >= ctx->mo_size - offset
+      || ctx->mo_data[offset + length] != '\0')
     return NULL;
 
-  err = grub_gettext_pread (ctx->fd_mo, translation, length, offset);
-  if (err)
-    {
-      grub_free (translation);
-      return NULL;
-    }
-  translation[length] = '\0';
-
-  return translation;
+  return ctx->mo_data + offset;
 }
 
 static const char *
 grub_gettext_gettranslation_from_position (struct grub_gettext_context *ctx,
 					   grub_size_t position)
 {
-  if (!ctx->grub_gettext_msg_list[position].translated)
-    ctx->grub_gettext_msg_list[position].translated
-      = grub_gettext_getstr_from_position (ctx,
-					   ctx->grub_gettext_offset_translation,
-					   position);
-  return ctx->grub_gettext_msg_list[position].translated;
+  const char *translation;
+  grub_err_t saved_errno = grub_errno;
+
+  if (ctx->translations[position])
+    return ctx->translations[position];
+
+  translation
+    = grub_gettext_getstr_from_position (ctx,
+					 ctx->grub_gettext_offset_translation,
+					 position);
+  if (!translation)
+    return NULL;
+
+  ctx->translations[position] = grub_strdup (translation);
+  grub_errno = saved_errno;
+  return ctx->translations[position];
 }
 
 static const char *
 grub_gettext_getstring_from_position (struct grub_gettext_context *ctx,
 				      grub_size_t position)
 {
-  if (!ctx->grub_gettext_msg_list[position].name)
-    ctx->grub_gettext_msg_list[position].name
-      = grub_gettext_getstr_from_position (ctx,
-					   ctx->grub_gettext_offset_original,
-					   position);
-  return ctx->grub_gettext_msg_list[position].name;
+  return grub_gettext_getstr_from_position (ctx,
+					    ctx->grub_gettext_offset_original,
+					    position);
+}
+
+/* The hash function msgfmt uses for the .mo hash table.  */
+static grub_uint32_t
+grub_gettext_hash (const char *str)
+{
+  grub_uint32_t hval = 0, g;
+
+  while (*str)
+    {
+      hval <<= 4;
+      hval += (grub_uint8_t) *str++;
+      g = hval & ((grub_uint32_t) 0xf << 28);
+      if (g != 0)
+	{
+	  hval ^= g >> 24;
+	  hval ^= g;
+	}
+    }
+  return hval;
+}
+
+static const char *
+grub_gettext_translate_hash (struct grub_gettext_context *ctx,
+			     const char *orig)
+{
+  grub_uint32_t hash_size = ctx->grub_gettext_hash_size;
+  grub_uint32_t hval = grub_gettext_hash (orig);
+  grub_uint32_t idx = hval % hash_size;
+  grub_uint32_t incr = 1 + (hval % (hash_size - 2));
+  grub_uint32_t tries;
+
+  /* Bound the probes in case the table is corrupted.  */
+  for (tries = 0; tries < hash_size; tries++)
+    {
+      grub_uint32_t nstr;
+      const char *current_string;
+
+      nstr = grub_gettext_get32 (ctx, ctx->grub_gettext_offset_hash
+				 + idx * sizeof (grub_uint32_t));
+      if (nstr == 0)
+	return NULL;
+      nstr--;
+
+      if (nstr < ctx->grub_gettext_max)
+	{
+	  current_string = grub_gettext_getstring_from_position (ctx, nstr);
+	  if (current_string && grub_strcmp (current_string, orig) == 0)
+	    return grub_gettext_gettranslation_from_position (ctx, nstr);
+	}
+
+      if (idx >= hash_size - incr)
+	idx -= hash_size - incr;
+      else
+	idx += incr;
+    }
+  return NULL;
 }
 
 static const char *
@@ -155,20 +213,12 @@ grub_gettext_translate_real (struct grub_gettext_context *ctx,
   grub_size_t current = 0;
   int i;
   const char *current_string;
-  static int depth = 0;
 
-  if (!ctx->grub_gettext_msg_list || !ctx->fd_mo)
+  if (!ctx->mo_data)
     return NULL;
 
-  /* Shouldn't happen. Just a precaution if our own code
-     calls gettext somehow.  */
-  if (depth > 2)
-    return NULL;
-  depth++;
-
-  /* Make sure we can use grub_gettext_translate for error messages.  Push
-     active error message to error stack and reset error message.  */
-  grub_error_push ();
+  if (ctx->grub_gettext_hash_size > 2)
+    return grub_gettext_translate_hash (ctx, orig);
 
   for (i = ctx->grub_gettext_max_log; i >= 0; i--)
     {
@@ -182,32 +232,14 @@ grub_gettext_translate_real (struct grub_gettext_context *ctx,
       current_string = grub_gettext_getstring_from_position (ctx, test);
 
       if (!current_string)
-	{
-	  grub_errno = GRUB_ERR_NONE;
-	  grub_error_pop ();
-	  depth--;
-	  return NULL;
-	}
+	return NULL;
 
       /* Search by bisection.  */
       cmp = grub_strcmp (current_string, orig);
       if (cmp <= 0)
 	current = test;
       if (cmp == 0)
-	{
-	  const char *ret = 0;
-	  ret = grub_gettext_gettranslation_from_position (ctx, current);
-	  if (!ret)
-	    {
-	      grub_errno = GRUB_ERR_NONE;
-	      grub_error_pop ();
-	      depth--;
-	      return NULL;
-	    }
-	  grub_error_pop ();
-	  depth--;
-	  return ret;      
-	}
+	return grub_gettext_gettranslation_from_position (ctx, current);
     }
 
   if (current == 0 && ctx->grub_gettext_max != 0)
@@ -215,32 +247,12 @@ grub_gettext_translate_real (struct grub_gettext_context *ctx,
       current_string = grub_gettext_getstring_from_position (ctx, 0);
 
       if (!current_string)
-	{
-	  grub_errno = GRUB_ERR_NONE;
-	  grub_error_pop ();
-	  depth--;
-	  return NULL;
-	}
+	return NULL;
 
       if (grub_strcmp (current_string, orig) == 0)
-	{
-	  const char *ret = 0;
-	  ret = grub_gettext_gettranslation_from_position (ctx, current);
-	  if (!ret)
-	    {
-	      grub_errno = GRUB_ERR_NONE;
-	      grub_error_pop ();
-	      depth--;
-	      return NULL;
-	    }
-	  grub_error_pop ();
-	  depth--;
-	  return ret;      
-	}
+	return grub_gettext_gettranslation_from_position (ctx, current);
     }
 
-  grub_error_pop ();
-  depth--;
   return NULL;
 }
 
@@ -263,56 +275,103 @@ grub_gettext_translate (const char *orig)
 static void
 grub_gettext_delete_list (struct grub_gettext_context *ctx)
 {
-  struct grub_gettext_msg *l = ctx->grub_gettext_msg_list;
-  grub_size_t i;
-
-  if (!l)
-    return;
-  ctx->grub_gettext_msg_list = 0;
-  for (i = 0; i < ctx->grub_gettext_max; i++)
-    grub_free (l[i].name);
-  /* Don't delete the translated message because could be in use.  */
-  grub_free (l);
-  if (ctx->fd_mo)
-    grub_file_close (ctx->fd_mo);
-  ctx->fd_mo = 0;
+  /* Don't free the translations themselves because they could be in
+     use.  */
+  grub_free (ctx->mo_data);
+  grub_free (ctx->translations);
   grub_memset (ctx, 0, sizeof (*ctx));
 }
 
+/* Read all of FD into memory.  */
+static char *
+grub_gettext_read_file (grub_file_t fd, grub_size_t *size)
+{
+  char *data = NULL, *new_data;
+  grub_size_t len = 0, alloc;
+  grub_ssize_t got;
+
+  if (fd->size != GRUB_FILE_SIZE_UNKNOWN)
+    {
+      if (fd->size != (grub_size_t) fd->size)
+	{
+	  grub_error (GRUB_ERR_OUT_OF_MEMORY, N_("out of memory"));
+	  return NULL;
+	}
+      data = grub_malloc (fd->size);
+      if (!data)
+	return NULL;
+      if (grub_gettext_pread (fd, data, fd->size, 0))
+	{
+	  grub_free (data);
+	  return NULL;
+	}
+      *size = fd->size;
+      return data;
+    }
+
+  /* Compressed files over the network may not know their size.  */
+  for (alloc = 65536; ; alloc *= 2)
+    {
+      new_data = grub_realloc (data, alloc);
+      if (!new_data)
+	{
+	  grub_free (data);
+	  return NULL;
+	}
+      data = new_data;
+      got = grub_file_read (fd, data + len, alloc - len);
+      if (got < 0)
+	{
+	  grub_free (data);
+	  return NULL;
+	}
+      len += got;
+      if (len < alloc)
+	break;
+    }
+  *size = len;
+  return data;
+}
+
 /* This is similar to grub_file_open. */
 static grub_err_t
 grub_mofile_open (struct grub_gettext_context *ctx,
 		  const char *filename)
 {
   struct header head;
-  grub_err_t err;
   grub_file_t fd;
-
-  /* Using fd_mo and not another variable because
-     it's needed for grub_gettext_get_info.  */
+  char *data;
+  grub_size_t size;
+  grub_uint64_t max;
 
   fd = grub_file_open (filename);
 
   if (!fd)
     return grub_errno;
 
-  err = grub_gettext_pread (fd, &head, sizeof (head), 0);
-  if (err)
+  data = grub_gettext_read_file (fd, &size);
+  grub_file_close (fd);
+  if (!data)
+    return grub_errno;
+
+  if (size < sizeof (head))
     {
-      grub_file_close (fd);
-      return err;
+      grub_free (data);
+      return grub_error (GRUB_ERR_BAD_FILE_TYPE,
+			 "mo: file too short: %s", filename);
     }
+  grub_memcpy (&head, data, sizeof (head));
 
   if (head.magic != grub_cpu_to_le32_compile_time (MO_MAGIC_NUMBER))
     {
-      grub_file_close (fd);
+      grub_free (data);
       return grub_error (GRUB_ERR_BAD_FILE_TYPE,
 			 "mo: invalid mo magic in file: %s", filename);
     }
 
   if (head.version != 0)
     {
-      grub_file_close (fd);
+      grub_free (data);
       return grub_error (GRUB_ERR_BAD_FILE_TYPE,
 			 "mo: invalid mo version in file: %s", filename);
     }
@@ -320,17 +379,40 @@ grub_mofile_open (struct grub_gettext_context *ctx,
   ctx->grub_gettext_offset_original = grub_le_to_cpu32 (head.offset_original);
   ctx->grub_gettext_offset_translation = grub_le_to_cpu32 (head.offset_translation);
   ctx->grub_gettext_max = grub_le_to_cpu32 (head.number_of_strings);
+  ctx->grub_gettext_hash_size = grub_le_to_cpu32 (head.hash_size);
+  ctx->grub_gettext_offset_hash = grub_le_to_cpu32 (head.offset_hash);
+
+  /* Make sure the tables lie within the file so lookups needn't check.  */
+  max = (grub_uint64_t) ctx->grub_gettext_max
+    * sizeof (struct string_descriptor);
+  if (ctx->grub_gettext_offset_original + max > size
+      || ctx->grub_gettext_offset_translation + max > size)
+    {
+      grub_free (data);
+      grub_memset (ctx, 0, sizeof (*ctx));
+      return grub_error (GRUB_ERR_BAD_FILE_TYPE,
+			 "mo: invalid string table in file: %s", filename);
+    }
+  /* An unusable hash table only costs speed: fall back to bisection.  */
+  if (ctx->grub_gettext_offset_hash
+      + (grub_uint64_t) ctx->grub_gettext_hash_size * sizeof (grub_uint32_t)
+      > size)
+    ctx->grub_gettext_hash_size = 0;
+
   for (ctx->grub_gettext_max_log = 0; ctx->grub_gettext_max >> ctx->grub_gettext_max_log;
        ctx->grub_gettext_max_log++);
 
-  ctx->grub_gettext_msg_list = grub_zalloc (ctx->grub_gettext_max
-					    * sizeof (ctx->grub_gettext_msg_list[0]));
-  if (!ctx->grub_gettext_msg_list)
+  ctx->translations = grub_zalloc (ctx->grub_gettext_max
+				   * sizeof (ctx->translations[0]));
+  if (!ctx->translations && ctx->grub_gettext_max)
     {
-      grub_file_close (fd);
+      grub_free (data);
+      grub_memset (ctx, 0, sizeof (*ctx));
       return grub_errno;
     }
-  ctx->fd_mo = fd;
+
+  ctx->mo_data = data;
+  ctx->mo_size = size;
   if (grub_gettext != grub_gettext_translate)
     {
       grub_gettext_original = grub_gettext;
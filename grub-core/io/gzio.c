@@ -43,6 +43,7 @@
 #include <grub/dl.h>
 #include <grub/deflate.h>
 #include <grub/i18n.h>
+#include <grub/env.h>
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
@@ -57,6 +58,32 @@ GRUB_MOD_LICENSE ("GPLv3+");
 
 #define INBUFSIZ  0x2000
 
+/* Set to 0 to build only the byte-at-a-time decoder.  */
+#ifndef GRUB_GZIO_FAST_INFLATE
+#define GRUB_GZIO_FAST_INFLATE 1
+#endif
+
+/* Initial distance in uncompressed data between access points. When the
+   index is full every other point is dropped and the distance doubled.  */
+#define INDEX_SPAN	0x100000
+#define INDEX_MAX	64
+
+/* An access point: the decompressor state at a block boundary, from which
+   decompression can resume without starting from the beginning.  */
+struct grub_gzio_point
+{
+  /* The offset in uncompressed data.  */
+  grub_off_t out;
+  /* The offset of the next input byte.  */
+  grub_off_t in;
+  /* The bit buffer.  */
+  unsigned long bb;
+  unsigned bk;
+  /* The position in and the contents of the sliding window.  */
+  unsigned wp;
+  grub_uint8_t slide[WSIZE];
+};
+
 /* The state stored in filesystem-specific data.  */
 struct grub_gzio
 {
@@ -82,6 +109,8 @@ struct grub_gzio
   /* The input buffer.  */
   grub_uint8_t inbuf[INBUFSIZ];
   int inbuf_d;
+  /* The offset of INBUF in the underlying file.  */
+  grub_off_t inbuf_off;
   /* The bit buffer.  */
   unsigned long bb;
   /* The bits in the bit buffer.  */
@@ -100,6 +129,14 @@ struct grub_gzio
   int bd;
   /* The original offset value.  */
   grub_off_t saved_offset;
+  /* Set if inflate_codes_fast may be used.  */
+  int fast_inflate;
+  /* Set if the window was restored from an access point.  */
+  int resume;
+  /* The access points, sorted by offset.  */
+  struct grub_gzio_point **index;
+  unsigned index_len;
+  grub_off_t index_span;
 };
 typedef struct grub_gzio *grub_gzio_t;
 
@@ -383,6 +420,7 @@ get_byte (grub_gzio_t gzio)
 		     || gzio->inbuf_d == INBUFSIZ))
     {
       gzio->inbuf_d = 0;
+      gzio->inbuf_off = grub_file_tell (gzio->file);
       grub_file_read (gzio->file, gzio->inbuf, INBUFSIZ);
     }
 
@@ -629,6 +667,190 @@ huft_free (struct huft *t)
 }
 
 
+#if GRUB_GZIO_FAST_INFLATE
+
+/* The fast loop refills the bit buffer with one 8-byte load.  */
+#define FAST_IN_MARGIN	8
+/* The fast loop needs room in the window for the longest match.  */
+#define FAST_OUT_MARGIN	258
+
+/* Return the buffered input and store the number of bytes in it in
+   AVAIL.  */
+static grub_uint8_t *
+fast_input (grub_gzio_t gzio, grub_size_t *avail)
+{
+  if (gzio->mem_input)
+    {
+      *avail = gzio->mem_input_size - gzio->mem_input_off;
+      return gzio->mem_input + gzio->mem_input_off;
+    }
+
+  /* The input buffer is not loaded until get_byte is first called.  */
+  if (grub_file_tell (gzio->file) == (grub_off_t) gzio->data_offset)
+    *avail = 0;
+  else
+    *avail = INBUFSIZ - gzio->inbuf_d;
+  return gzio->inbuf + gzio->inbuf_d;
+}
+
+/*
+ *  Decode literals and matches straight out of the input buffer while at
+ *  least FAST_IN_MARGIN bytes are buffered and FAST_OUT_MARGIN bytes are
+ *  left in the window.  The bit buffer is 64 bits wide and is topped up
+ *  with a single unaligned load, which covers the longest length/distance
+ *  pair, so no bounds checks are needed in the loop.
+ *  Whole bytes that were loaded but not consumed are given back on exit.
+ *  Return 1 at the end of the block, -1 on error, or 0 if the margins
+ *  ran out.
+ */
+
+static int
+inflate_codes_fast (grub_gzio_t gzio)
+{
+  grub_uint8_t *slide = gzio->slide;
+  grub_uint8_t *in, *start, *last;
+  grub_size_t avail;
+  grub_uint64_t b;		/* bit buffer */
+  unsigned k;			/* number of bits in bit buffer */
+  unsigned w;			/* current window position */
+  unsigned e, n, d;
+  unsigned ml, md;
+  struct huft *t;
+  int ret = 0;
+
+  start = in = fast_input (gzio, &avail);
+  if (avail < FAST_IN_MARGIN)
+    return 0;
+  last = in + avail - FAST_IN_MARGIN;
+
+  b = gzio->bb;
+  k = gzio->bk;
+  w = gzio->wp;
+  ml = mask_bits[gzio->bl];
+  md = mask_bits[gzio->bd];
+
+  while (in <= last && w <= WSIZE - FAST_OUT_MARGIN)
+    {
+      /* A length/distance pair takes at most 48 bits. Refill up to at
+	 least 56 bits; the bits above K are the start of the next byte,
+	 so they are simply loaded again.  */
+      if (k < 48)
+	{
+	  b |= grub_le_to_cpu64 (grub_get_unaligned64 (in)) << k;
+	  in += (63 - k) >> 3;
+	  k |= 56;
+	}
+
+      t = gzio->tl + ((unsigned) b & ml);
+      while ((e = t->e) > 16)
+	{
+	  if (e == 99)
+	    goto unused;
+	  b >>= t->b;
+	  k -= t->b;
+	  t = t->v.t + ((unsigned) b & mask_bits[e - 16]);
+	}
+      b >>= t->b;
+      k -= t->b;
+
+      if (e == 16)
+	{
+	  slide[w++] = (uch) t->v.n;
+	  continue;
+	}
+
+      if (e == 15)
+	{
+	  gzio->block_len = 0;
+	  ret = 1;
+	  break;
+	}
+
+      n = t->v.n + ((unsigned) b & mask_bits[e]);
+      b >>= e;
+      k -= e;
+
+      t = gzio->td + ((unsigned) b & md);
+      while ((e = t->e) > 16)
+	{
+	  if (e == 99)
+	    goto unused;
+	  b >>= t->b;
+	  k -= t->b;
+	  t = t->v.t + ((unsigned) b & mask_bits[e - 16]);
+	}
+      b >>= t->b;
+      k -= t->b;
+      d = t->v.n + ((unsigned) b & mask_bits[e]);
+      b >>= e;
+      k -= e;
+
+      if (d > w)
+	{
+	  /* The start of the match wraps around the end of the window.
+	     The source is always ahead of the destination here.  */
+	  unsigned s = WSIZE + w - d;
+
+	  e = WSIZE - s;
+	  if (e > n)
+	    e = n;
+	  grub_memmove (slide + w, slide + s, e);
+	  w += e;
+	  n -= e;
+	  if (! n)
+	    continue;
+	}
+
+      if (d >= 8)
+	{
+	  grub_uint8_t *from = slide + w - d, *to = slide + w;
+
+	  w += n;
+	  for (; n >= 8; n -= 8, from += 8, to += 8)
+	    grub_set_unaligned64 (to, grub_get_unaligned64 (from));
+	  while (n--)
+	    *to++ = *from++;
+	}
+      else if (d == 1)
+	{
+	  grub_memset (slide + w, slide[w - 1], n);
+	  w += n;
+	}
+      else
+	{
+	  /* Short overlapping match: the copy repeats its own output.  */
+	  for (; n; n--, w++)
+	    slide[w] = slide[w - d];
+	}
+    }
+
+  /* Give back the bytes loaded in this call that were not used.  The
+     remaining bits then fit in the regular bit buffer.  */
+  n = k >> 3;
+  if (n > (unsigned) (in - start))
+    n = in - start;
+  in -= n;
+  k -= n << 3;
+  b &= ((grub_uint64_t) 1 << k) - 1;
+
+  if (gzio->mem_input)
+    gzio->mem_input_off += in - start;
+  else
+    gzio->inbuf_d += in - start;
+
+  gzio->bb = b;
+  gzio->bk = k;
+  gzio->wp = w;
+
+  return ret;
+
+ unused:
+  grub_error (GRUB_ERR_BAD_COMPRESSED_DATA, "an unused code found");
+  return -1;
+}
+
+#endif
+
 /*
  *  inflate (decompress) the codes in a deflated (compressed) block.
  *  Return an error code or zero if it all goes ok.
@@ -659,6 +881,25 @@ inflate_codes_in_window (grub_gzio_t gzio)
     {
       if (! gzio->code_state)
 	{
+#if GRUB_GZIO_FAST_INFLATE
+	  if (gzio->fast_inflate && w <= WSIZE - FAST_OUT_MARGIN)
+	    {
+	      int r;
+
+	      gzio->bb = b;
+	      gzio->bk = k;
+	      gzio->wp = w;
+	      r = inflate_codes_fast (gzio);
+	      if (r < 0)
+		return 1;
+	      b = gzio->bb;
+	      k = gzio->bk;
+	      w = gzio->wp;
+	      if (r)
+		break;
+	    }
+#endif
+
 	  NEEDBITS ((unsigned) gzio->bl);
 	  if ((e = (t = gzio->tl + ((unsigned) b & ml))->e) > 16)
 	    do
@@ -861,6 +1102,7 @@ init_dynamic_block (grub_gzio_t gzio)
   unsigned nl;			/* number of literal/length codes */
   unsigned nd;			/* number of distance codes */
   unsigned ll[286 + 30];	/* literal/length and distance code lengths */
+  struct huft *t;		/* pointer to table entry */
   register ulg b;		/* bit buffer */
   register unsigned k;		/* number of bits in bit buffer */
 
@@ -910,9 +1152,9 @@ init_dynamic_block (grub_gzio_t gzio)
   while ((unsigned) i < n)
     {
       NEEDBITS ((unsigned) gzio->bl);
-      j = (gzio->td = gzio->tl + ((unsigned) b & m))->b;
+      j = (t = gzio->tl + ((unsigned) b & m))->b;
       DUMPBITS (j);
-      j = gzio->td->v.n;
+      j = t->v.n;
       if (j < 16)		/* length of code in bits (0..15) */
 	ll[i++] = l = j;	/* save last length in l */
       else if (j == 16)		/* repeat last length 3 to 6 times */
@@ -1033,11 +1275,126 @@ get_new_block (grub_gzio_t gzio)
 }
 
 
+/* Record an access point if the last one is far enough behind. Must be
+   called between blocks.  */
+static void
+add_point (grub_gzio_t gzio)
+{
+  grub_off_t out = gzio->saved_offset + gzio->wp;
+  struct grub_gzio_point *point;
+
+  if (!gzio->index_span)
+    gzio->index_span = INDEX_SPAN;
+
+  if (out < (gzio->index_len ? gzio->index[gzio->index_len - 1]->out : 0)
+      + gzio->index_span)
+    return;
+
+  if (!gzio->index)
+    {
+      gzio->index = grub_malloc (INDEX_MAX * sizeof (gzio->index[0]));
+      if (!gzio->index)
+	{
+	  grub_errno = GRUB_ERR_NONE;
+	  return;
+	}
+    }
+
+  if (gzio->index_len == INDEX_MAX)
+    {
+      unsigned i;
+
+      for (i = 0; i < INDEX_MAX; i++)
+	if (i & 1)
+	  gzio->index[i / 2] = gzio->index[i];
+	else
+	  grub_free (gzio->index[i]);
+      gzio->index_len = INDEX_MAX / 2;
+      gzio->index_span *= 2;
+      if (out < gzio->index[gzio->index_len - 1]->out + gzio->index_span)
+	return;
+    }
+
+  point = grub_malloc (sizeof (*point));
+  if (!point)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+
+  point->out = out;
+  if (gzio->mem_input)
+    point->in = gzio->mem_input_off;
+  else
+    point->in = gzio->inbuf_off + gzio->inbuf_d;
+  point->bb = gzio->bb;
+  point->bk = gzio->bk;
+  point->wp = gzio->wp;
+  grub_memcpy (point->slide, gzio->slide, WSIZE);
+  gzio->index[gzio->index_len++] = point;
+}
+
+/* Return the last access point not after OFFSET, if any.  */
+static struct grub_gzio_point *
+find_point (grub_gzio_t gzio, grub_off_t offset)
+{
+  unsigned lo = 0, hi = gzio->index_len;
+
+  while (lo < hi)
+    {
+      unsigned mid = (lo + hi) / 2;
+      if (gzio->index[mid]->out <= offset)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+
+  return lo ? gzio->index[lo - 1] : 0;
+}
+
+static void
+restore_point (grub_gzio_t gzio, struct grub_gzio_point *point)
+{
+  huft_free (gzio->tl);
+  huft_free (gzio->td);
+  gzio->tl = 0;
+  gzio->td = 0;
+
+  gzio_seek (gzio, point->in);
+  /* Force a refill of the input buffer.  */
+  gzio->inbuf_d = INBUFSIZ;
+
+  gzio->bb = point->bb;
+  gzio->bk = point->bk;
+  gzio->last_block = 0;
+  gzio->block_len = 0;
+
+  grub_memcpy (gzio->slide, point->slide, WSIZE);
+  gzio->wp = point->wp;
+  gzio->saved_offset = point->out - point->wp;
+  gzio->resume = 1;
+}
+
+static void
+free_index (grub_gzio_t gzio)
+{
+  unsigned i;
+
+  for (i = 0; i < gzio->index_len; i++)
+    grub_free (gzio->index[i]);
+  grub_free (gzio->index);
+  gzio->index = 0;
+  gzio->index_len = 0;
+}
+
 static void
 inflate_window (grub_gzio_t gzio)
 {
   /* initialize window */
-  gzio->wp = 0;
+  if (gzio->resume)
+    gzio->resume = 0;
+  else
+    gzio->wp = 0;
 
   /*
    *  Main decompression loop.
@@ -1050,6 +1407,7 @@ inflate_window (grub_gzio_t gzio)
 	  if (gzio->last_block)
 	    break;
 
+	  add_point (gzio);
 	  get_new_block (gzio);
 	}
 
@@ -1118,6 +1476,24 @@ initialize_tables (grub_gzio_t gzio)
   /* Reset memory allocation stuff.  */
   huft_free (gzio->tl);
   huft_free (gzio->td);
+  gzio->tl = 0;
+  gzio->td = 0;
+  gzio->resume = 0;
+}
+
+
+/* The fast decoder can be turned off at run time by setting
+   gzio_fast_inflate to 0, so that both decoders can be compared.  */
+static int
+use_fast_inflate (void)
+{
+#if GRUB_GZIO_FAST_INFLATE
+  const char *val = grub_env_get ("gzio_fast_inflate");
+
+  return ! val || grub_strcmp (val, "0") != 0;
+#else
+  return 0;
+#endif
 }
 
 
@@ -1142,6 +1518,7 @@ grub_gzio_open (grub_file_t io, const char *name __attribute__ ((unused)))
     }
 
   gzio->file = io;
+  gzio->fast_inflate = use_fast_inflate ();
 
   file->device = io->device;
   file->data = gzio;
@@ -1202,9 +1579,16 @@ grub_gzio_read_real (grub_gzio_t gzio, grub_off_t offset,
 		     char *buf, grub_size_t len)
 {
   grub_ssize_t ret = 0;
-
-  /* Do we reset decompression to the beginning of the file?  */
-  if (gzio->saved_offset > offset + WSIZE)
+  struct grub_gzio_point *point;
+
+  /* Resume from the closest access point if it is ahead of the current
+     position, or if we need to go back. Otherwise reset decompression to
+     the beginning of the file when going back.  */
+  point = find_point (gzio, offset);
+  if (point && (gzio->saved_offset > offset + WSIZE
+		|| point->out > gzio->saved_offset))
+    restore_point (gzio, point);
+  else if (gzio->saved_offset > offset + WSIZE)
     initialize_tables (gzio);
 
   /*
@@ -1255,6 +1639,7 @@ grub_gzio_close (grub_file_t file)
   grub_file_close (gzio->file);
   huft_free (gzio->tl);
   huft_free (gzio->td);
+  free_index (gzio);
   grub_free (gzio);
 
   /* No need to close the same device twice.  */
@@ -1276,6 +1661,7 @@ grub_zlib_decompress (char *inbuf, grub_size_t insize, grub_off_t off,
   gzio->mem_input = (grub_uint8_t *) inbuf;
   gzio->mem_input_size = insize;
   gzio->mem_input_off = 0;
+  gzio->fast_inflate = use_fast_inflate ();
 
   if (!test_zlib_header (gzio))
     {
@@ -1284,6 +1670,9 @@ grub_zlib_decompress (char *inbuf, grub_size_t insize, grub_off_t off,
     }
 
   ret = grub_gzio_read_real (gzio, off, outbuf, outsize);
+  huft_free (gzio->tl);
+  huft_free (gzio->td);
+  free_index (gzio);
   grub_free (gzio);
 
   /* FIXME: Check Adler.  */
@@ -33,6 +33,13 @@ GRUB_MOD_LICENSE ("GPLv3+");
 #define VLI_MAX_DIGITS 9
 #define XZ_STREAM_FOOTER_SIZE 12
 
+/* Start of a block in the compressed and in the uncompressed data.  */
+struct grub_xzio_block
+{
+  grub_off_t in;
+  grub_off_t out;
+};
+
 struct grub_xzio
 {
   grub_file_t file;
@@ -41,6 +48,12 @@ struct grub_xzio
   grub_uint8_t inbuf[XZBUFSIZ];
   grub_uint8_t outbuf[XZBUFSIZ];
   grub_off_t saved_offset;
+  /* The blocks as listed in the stream index.  */
+  struct grub_xzio_block *blocks;
+  grub_size_t num_blocks;
+  /* Set when decoding didn't start at the first block. The decoder then
+     can't verify the index against the blocks it has seen.  */
+  int skipped_blocks;
 };
 
 typedef struct grub_xzio *grub_xzio_t;
@@ -121,8 +134,11 @@ test_footer (grub_file_t file)
   grub_uint32_t backsize;
   grub_uint8_t imarker;
   grub_uint64_t uncompressed_size_total = 0;
+  grub_uint64_t compressed_offset = STREAM_HEADER_SIZE;
+  grub_uint64_t unpadded_size;
   grub_uint64_t uncompressed_size;
   grub_uint64_t records;
+  grub_size_t i;
 
   grub_file_seek (xzio->file, xzio->file->size - FOOTER_MAGIC_SIZE);
   if (grub_file_read (xzio->file, footer, FOOTER_MAGIC_SIZE)
@@ -150,13 +166,31 @@ test_footer (grub_file_t file)
   if (read_vli (xzio->file, &records) <= 0)
     goto ERROR;
 
-  for (; records != 0; records--)
+  /* Remember where the blocks start so that seeking can skip the ones
+     before the target. It's just an optimization, so ignore allocation
+     failures.  */
+  if (records > 1 && records < GRUB_SIZE_MAX / sizeof (xzio->blocks[0]))
+    {
+      xzio->blocks = grub_malloc (records * sizeof (xzio->blocks[0]));
+      if (!xzio->blocks)
+	grub_errno = GRUB_ERR_NONE;
+    }
+
+  for (i = 0; records != 0; records--, i++)
     {
-      if (read_vli (xzio->file, &uncompressed_size) <= 0)	/* Ignore unpadded.  */
+      if (read_vli (xzio->file, &unpadded_size) <= 0)
 	goto ERROR;
       if (read_vli (xzio->file, &uncompressed_size) <= 0)	/* Uncompressed.  */
 	goto ERROR;
 
+      if (xzio->blocks)
+	{
+	  xzio->blocks[i].in = compressed_offset;
+	  xzio->blocks[i].out = uncompressed_size_total;
+	  xzio->num_blocks = i + 1;
+	}
+
+      compressed_offset += ALIGN_UP (unpadded_size, 4);
       uncompressed_size_total += uncompressed_size;
     }
 
@@ -165,9 +199,57 @@ test_footer (grub_file_t file)
   return 1;
 
 ERROR:
+  grub_free (xzio->blocks);
+  xzio->blocks = 0;
+  xzio->num_blocks = 0;
   return 0;
 }
 
+/* Return the index of the last block starting at or before OFFSET.  */
+static grub_size_t
+find_block (grub_xzio_t xzio, grub_off_t offset)
+{
+  grub_size_t lo = 0, hi = xzio->num_blocks;
+
+  while (hi - lo > 1)
+    {
+      grub_size_t mid = (lo + hi) / 2;
+      if (xzio->blocks[mid].out <= offset)
+	lo = mid;
+      else
+	hi = mid;
+    }
+
+  return lo;
+}
+
+/* Restart decoding at block N.  */
+static grub_err_t
+seek_block (grub_xzio_t xzio, grub_size_t n)
+{
+  /* The decoder has to see the stream header before the first block it
+     decodes.  */
+  xz_dec_reset (xzio->dec);
+  xzio->buf.out_pos = 0;
+  xzio->buf.in_pos = 0;
+  grub_file_seek (xzio->file, 0);
+  xzio->buf.in_size = grub_file_read (xzio->file, xzio->inbuf,
+				      STREAM_HEADER_SIZE);
+  if (xzio->buf.in_size != STREAM_HEADER_SIZE
+      || xz_dec_run (xzio->dec, &xzio->buf) != XZ_OK)
+    return grub_error (GRUB_ERR_BAD_COMPRESSED_DATA,
+		       N_("xz file corrupted or unsupported block options"));
+
+  xzio->buf.out_pos = 0;
+  xzio->buf.in_pos = 0;
+  xzio->buf.in_size = 0;
+  grub_file_seek (xzio->file, xzio->blocks[n].in);
+  xzio->saved_offset = xzio->blocks[n].out;
+  xzio->skipped_blocks = (n != 0);
+
+  return GRUB_ERR_NONE;
+}
+
 static grub_file_t
 grub_xzio_open (grub_file_t io,
 		const char *name __attribute__ ((unused)))
@@ -235,12 +317,25 @@ grub_xzio_read (grub_file_t file, char *buf, grub_size_t len)
   grub_xzio_t xzio = file->data;
   grub_off_t current_offset;
 
-  /* If seek backward need to reset decoder and start from beginning of file.
-     TODO Possible improvement by jumping blocks.  */
+  /* Jump to the block containing the requested data when seeking backward
+     or when that block starts after the current position.  */
+  if (xzio->num_blocks)
+    {
+      grub_size_t n = find_block (xzio, file->offset);
+
+      if (file->offset < xzio->saved_offset
+	  || xzio->blocks[n].out > xzio->saved_offset)
+	if (seek_block (xzio, n))
+	  return -1;
+    }
+
+  /* If seek backward need to reset decoder and start from beginning of
+     file.  */
   if (file->offset < xzio->saved_offset)
     {
       xz_dec_reset (xzio->dec);
       xzio->saved_offset = 0;
+      xzio->skipped_blocks = 0;
       xzio->buf.out_pos = 0;
       xzio->buf.in_pos = 0;
       xzio->buf.in_size = 0;
@@ -265,6 +360,15 @@ grub_xzio_read (grub_file_t file, char *buf, grub_size_t len)
 	}
 
       xzret = xz_dec_run (xzio->dec, &xzio->buf);
+
+      /* After skipping blocks the index doesn't match what the decoder has
+	 seen. That's only detected once all data has been output and every
+	 block check has passed, so any earlier error is still reported.  */
+      if (xzret == XZ_DATA_ERROR && xzio->skipped_blocks
+	  && current_offset + xzio->buf.out_pos >= file->size
+	  && xz_dec_past_blocks (xzio->dec))
+	xzret = XZ_STREAM_END;
+
       switch (xzret)
 	{
 	case XZ_MEMLIMIT_ERROR:
@@ -315,6 +419,7 @@ grub_xzio_close (grub_file_t file)
   xz_dec_end (xzio->dec);
 
   grub_file_close (xzio->file);
+  grub_free (xzio->blocks);
   grub_free (xzio);
 
   /* Device must not be closed twice.  */
@@ -22,6 +22,35 @@
 
 grub_command_t grub_command_list;
 
+/* The size of the command hash table.  Must be a power of 2.  */
+#define GRUB_COMMAND_HASH_SIZE	128
+
+/* The active command of each name, chained through hash_next.  */
+static grub_command_t grub_command_hash[GRUB_COMMAND_HASH_SIZE];
+
+static grub_command_t *
+grub_command_hash_bucket (const char *s)
+{
+  grub_uint32_t key = 2166136261U;
+
+  while (*s)
+    key = (key ^ (grub_uint8_t) *s++) * 16777619;
+
+  return &grub_command_hash[(key ^ (key >> 16)) & (GRUB_COMMAND_HASH_SIZE - 1)];
+}
+
+grub_command_t
+grub_command_find (const char *name)
+{
+  grub_command_t cmd;
+
+  for (cmd = *grub_command_hash_bucket (name); cmd; cmd = cmd->hash_next)
+    if (grub_strcmp (cmd->name, name) == 0)
+      return cmd;
+
+  return 0;
+}
+
 grub_command_t
 grub_register_command_prio (const char *name,
 			    grub_command_func_t func,
@@ -72,7 +101,25 @@ grub_register_command_prio (const char *name,
   cmd->prev = p;
 
   if (! inactive)
-    cmd->prio |= GRUB_COMMAND_FLAG_ACTIVE;
+    {
+      grub_command_t *h;
+
+      cmd->prio |= GRUB_COMMAND_FLAG_ACTIVE;
+
+      /* CMD now heads the run of commands named NAME, so it replaces
+	 the previous head (if any) in the hash.  */
+      h = grub_command_hash_bucket (name);
+      if (q && grub_strcmp (q->name, name) == 0)
+	{
+	  while (*h != q)
+	    h = &(*h)->hash_next;
+	  cmd->hash_next = q->hash_next;
+	  q->hash_next = 0;
+	}
+      else
+	cmd->hash_next = *h;
+      *h = cmd;
+    }
 
   return cmd;
 }
@@ -80,6 +127,22 @@ grub_register_command_prio (const char *name,
 void
 grub_unregister_command (grub_command_t cmd)
 {
+  grub_command_t *h;
+
+  for (h = grub_command_hash_bucket (cmd->name); *h; h = &(*h)->hash_next)
+    if (*h == cmd)
+      {
+	/* The next command of the same name, if any, takes over.  */
+	if (cmd->next && grub_strcmp (cmd->next->name, cmd->name) == 0)
+	  {
+	    cmd->next->hash_next = cmd->hash_next;
+	    *h = cmd->next;
+	  }
+	else
+	  *h = cmd->hash_next;
+	break;
+      }
+
   if ((cmd->prio & GRUB_COMMAND_FLAG_ACTIVE) && (cmd->next))
     cmd->next->prio |= GRUB_COMMAND_FLAG_ACTIVE;
   grub_list_remove (GRUB_AS_LIST (cmd));
@@ -25,6 +25,9 @@
 #include <grub/time.h>
 #include <grub/file.h>
 #include <grub/i18n.h>
+#if !defined (GRUB_MACHINE_EMU) && !defined (GRUB_UTIL)
+#include <grub/mm_private.h>
+#endif
 
 #define	GRUB_CACHE_TIMEOUT	2
 
@@ -40,9 +43,16 @@ struct grub_disk_cache
   grub_disk_addr_t sector;
   char *data;
   int lock;
+  /* Value of grub_disk_cache_clock when the entry was last used.  */
+  unsigned long last_use;
 };
 
-static struct grub_disk_cache grub_disk_cache_table[GRUB_DISK_CACHE_NUM];
+/* GRUB_DISK_CACHE_WAYS consecutive entries form one set.  */
+static struct grub_disk_cache *grub_disk_cache_table;
+static unsigned grub_disk_cache_num_sets;
+static unsigned long grub_disk_cache_clock;
+
+grub_size_t grub_disk_readahead_max = GRUB_DISK_READAHEAD_MAX;
 
 void (*grub_disk_firmware_fini) (void);
 int grub_disk_firmware_is_tainted;
@@ -51,42 +61,136 @@ int grub_disk_firmware_is_tainted;
 static unsigned long grub_disk_cache_hits;
 static unsigned long grub_disk_cache_misses;
 
+static struct
+{
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long entries;
+} grub_disk_cache_dev_stats[GRUB_DISK_DEVICE_MAX_ID];
+
 void
 grub_disk_cache_get_performance (unsigned long *hits, unsigned long *misses)
 {
   *hits = grub_disk_cache_hits;
   *misses = grub_disk_cache_misses;
 }
+
+void
+grub_disk_cache_get_dev_performance (enum grub_disk_dev_id dev_id,
+				     unsigned long *hits,
+				     unsigned long *misses,
+				     unsigned long *entries)
+{
+  *hits = grub_disk_cache_dev_stats[dev_id].hits;
+  *misses = grub_disk_cache_dev_stats[dev_id].misses;
+  *entries = grub_disk_cache_dev_stats[dev_id].entries;
+}
+
+void
+grub_disk_cache_get_geometry (unsigned *sets, unsigned *ways)
+{
+  *sets = grub_disk_cache_num_sets;
+  *ways = GRUB_DISK_CACHE_WAYS;
+}
 #endif
 
-static unsigned
-grub_disk_cache_get_index (unsigned long dev_id, unsigned long disk_id,
-			   grub_disk_addr_t sector)
+/* Allocate the cache table. The number of sets is chosen so that a fully
+   populated cache uses at most 1/GRUB_DISK_CACHE_HEAP_FRACTION of the
+   heap.  */
+static void
+grub_disk_cache_init (void)
 {
-  return ((dev_id * 524287UL + disk_id * 2606459UL
-	   + ((unsigned) (sector >> GRUB_DISK_CACHE_BITS)))
-	  % GRUB_DISK_CACHE_NUM);
+  grub_size_t entries;
+  unsigned sets;
+
+#if defined (GRUB_MACHINE_EMU) || defined (GRUB_UTIL)
+  entries = GRUB_DISK_CACHE_NUM * GRUB_DISK_CACHE_WAYS;
+#else
+  {
+    grub_mm_region_t r;
+    grub_size_t heap = 0;
+
+    for (r = grub_mm_base; r; r = r->next)
+      heap += r->size;
+    entries = (heap / GRUB_DISK_CACHE_HEAP_FRACTION)
+      >> (GRUB_DISK_CACHE_BITS + GRUB_DISK_SECTOR_BITS);
+  }
+#endif
+
+  sets = entries / GRUB_DISK_CACHE_WAYS;
+  if (sets < GRUB_DISK_CACHE_MIN_SETS)
+    sets = GRUB_DISK_CACHE_MIN_SETS;
+  if (sets > GRUB_DISK_CACHE_MAX_SETS)
+    sets = GRUB_DISK_CACHE_MAX_SETS;
+
+  grub_disk_cache_table = grub_zalloc (sets * GRUB_DISK_CACHE_WAYS
+				       * sizeof (grub_disk_cache_table[0]));
+  if (!grub_disk_cache_table)
+    {
+      /* Run uncached rather than failing the open.  */
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+  grub_disk_cache_num_sets = sets;
+  grub_dprintf ("disk", "cache: %u sets of %u ways\n", sets,
+		GRUB_DISK_CACHE_WAYS);
+}
+
+/* Return the first entry of the set holding SECTOR.  */
+static struct grub_disk_cache *
+grub_disk_cache_get_set (unsigned long dev_id, unsigned long disk_id,
+			 grub_disk_addr_t sector)
+{
+  unsigned index;
+
+  index = ((dev_id * 524287UL + disk_id * 2606459UL
+	    + ((unsigned) (sector >> GRUB_DISK_CACHE_BITS)))
+	   % grub_disk_cache_num_sets);
+  return grub_disk_cache_table + index * GRUB_DISK_CACHE_WAYS;
+}
+
+/* Return the entry caching SECTOR, or NULL.  */
+static struct grub_disk_cache *
+grub_disk_cache_lookup (unsigned long dev_id, unsigned long disk_id,
+			grub_disk_addr_t sector)
+{
+  struct grub_disk_cache *cache;
+  unsigned i;
+
+  if (!grub_disk_cache_num_sets)
+    return 0;
+
+  cache = grub_disk_cache_get_set (dev_id, disk_id, sector);
+  for (i = 0; i < GRUB_DISK_CACHE_WAYS; i++, cache++)
+    if (cache->data && cache->dev_id == dev_id && cache->disk_id == disk_id
+	&& cache->sector == sector)
+      return cache;
+
+  return 0;
+}
+
+static void
+grub_disk_cache_free_entry (struct grub_disk_cache *cache)
+{
+#if DISK_CACHE_STATS
+  grub_disk_cache_dev_stats[cache->dev_id].entries--;
+#endif
+  cache->lock = 1;
+  grub_free (cache->data);
+  cache->data = 0;
+  cache->lock = 0;
 }
 
 static void
 grub_disk_cache_invalidate (unsigned long dev_id, unsigned long disk_id,
 			    grub_disk_addr_t sector)
 {
-  unsigned index;
   struct grub_disk_cache *cache;
 
   sector &= ~(GRUB_DISK_CACHE_SIZE - 1);
-  index = grub_disk_cache_get_index (dev_id, disk_id, sector);
-  cache = grub_disk_cache_table + index;
-
-  if (cache->dev_id == dev_id && cache->disk_id == disk_id
-      && cache->sector == sector && cache->data)
-    {
-      cache->lock = 1;
-      grub_free (cache->data);
-      cache->data = 0;
-      cache->lock = 0;
-    }
+  cache = grub_disk_cache_lookup (dev_id, disk_id, sector);
+  if (cache)
+    grub_disk_cache_free_entry (cache);
 }
 
 void
@@ -94,15 +198,12 @@ grub_disk_cache_invalidate_all (void)
 {
   unsigned i;
 
-  for (i = 0; i < GRUB_DISK_CACHE_NUM; i++)
+  for (i = 0; i < grub_disk_cache_num_sets * GRUB_DISK_CACHE_WAYS; i++)
     {
       struct grub_disk_cache *cache = grub_disk_cache_table + i;
 
       if (cache->data && ! cache->lock)
-	{
-	  grub_free (cache->data);
-	  cache->data = 0;
-	}
+	grub_disk_cache_free_entry (cache);
     }
 }
 
@@ -111,23 +212,22 @@ grub_disk_cache_fetch (unsigned long dev_id, unsigned long disk_id,
 		       grub_disk_addr_t sector)
 {
   struct grub_disk_cache *cache;
-  unsigned index;
-
-  index = grub_disk_cache_get_index (dev_id, disk_id, sector);
-  cache = grub_disk_cache_table + index;
 
-  if (cache->dev_id == dev_id && cache->disk_id == disk_id
-      && cache->sector == sector)
+  cache = grub_disk_cache_lookup (dev_id, disk_id, sector);
+  if (cache)
     {
       cache->lock = 1;
+      cache->last_use = ++grub_disk_cache_clock;
 #if DISK_CACHE_STATS
       grub_disk_cache_hits++;
+      grub_disk_cache_dev_stats[dev_id].hits++;
 #endif
       return cache->data;
     }
 
 #if DISK_CACHE_STATS
   grub_disk_cache_misses++;
+  grub_disk_cache_dev_stats[dev_id].misses++;
 #endif
 
   return 0;
@@ -138,13 +238,9 @@ grub_disk_cache_unlock (unsigned long dev_id, unsigned long disk_id,
 			grub_disk_addr_t sector)
 {
   struct grub_disk_cache *cache;
-  unsigned index;
-
-  index = grub_disk_cache_get_index (dev_id, disk_id, sector);
-  cache = grub_disk_cache_table + index;
 
-  if (cache->dev_id == dev_id && cache->disk_id == disk_id
-      && cache->sector == sector)
+  cache = grub_disk_cache_lookup (dev_id, disk_id, sector);
+  if (cache)
     cache->lock = 0;
 }
 
@@ -152,16 +248,38 @@ static grub_err_t
 grub_disk_cache_store (unsigned long dev_id, unsigned long disk_id,
 		       grub_disk_addr_t sector, const char *data)
 {
-  unsigned index;
   struct grub_disk_cache *cache;
+  unsigned i;
 
-  index = grub_disk_cache_get_index (dev_id, disk_id, sector);
-  cache = grub_disk_cache_table + index;
+  if (!grub_disk_cache_num_sets)
+    return GRUB_ERR_NONE;
 
-  cache->lock = 1;
-  grub_free (cache->data);
-  cache->data = 0;
-  cache->lock = 0;
+  /* Reuse a stale copy if any, otherwise a free way, otherwise the least
+     recently used unlocked way.  */
+  cache = grub_disk_cache_lookup (dev_id, disk_id, sector);
+  if (!cache)
+    {
+      struct grub_disk_cache *set;
+
+      set = grub_disk_cache_get_set (dev_id, disk_id, sector);
+      for (i = 0; i < GRUB_DISK_CACHE_WAYS; i++)
+	{
+	  if (set[i].lock)
+	    continue;
+	  if (!set[i].data)
+	    {
+	      cache = &set[i];
+	      break;
+	    }
+	  if (!cache || set[i].last_use < cache->last_use)
+	    cache = &set[i];
+	}
+    }
+
+  if (!cache || cache->lock)
+    return GRUB_ERR_NONE;
+  if (cache->data)
+    grub_disk_cache_free_entry (cache);
 
   cache->data = grub_malloc (GRUB_DISK_SECTOR_SIZE << GRUB_DISK_CACHE_BITS);
   if (! cache->data)
@@ -172,11 +290,15 @@ grub_disk_cache_store (unsigned long dev_id, unsigned long disk_id,
   cache->dev_id = dev_id;
   cache->disk_id = disk_id;
   cache->sector = sector;
+  cache->last_use = ++grub_disk_cache_clock;
+#if DISK_CACHE_STATS
+  grub_disk_cache_dev_stats[dev_id].entries++;
+#endif
 
   return GRUB_ERR_NONE;
 }
 
-
+
 
 grub_disk_dev_t grub_disk_dev_list;
 
@@ -291,6 +413,9 @@ grub_disk_open (const char *name)
 	}
     }
 
+  if (!grub_disk_cache_table)
+    grub_disk_cache_init ();
+
   /* The cache will be invalidated about 2 seconds after a device was
      closed.  */
   current_time = grub_get_time_ms ();
@@ -470,6 +595,92 @@ grub_disk_read_small (grub_disk_t disk, grub_disk_addr_t sector,
   }
 }
 
+/* Detect sequential reads and, when one misses the cache, read the
+   requested range together with the following RA_WINDOW cache units in a
+   single device request. The window doubles on every such miss up to
+   grub_disk_readahead_max. SECTOR is already adjusted.  */
+static void
+grub_disk_readahead (grub_disk_t disk, grub_disk_addr_t sector,
+		     grub_off_t offset, grub_size_t size)
+{
+  grub_disk_addr_t start, end;
+  grub_size_t max, n, i;
+  int sequential;
+  char *tmp_buf;
+
+  end = sector + ((offset + size + GRUB_DISK_SECTOR_SIZE - 1)
+		  >> GRUB_DISK_SECTOR_BITS);
+  /* Accept the last sector of the previous read again, as happens with
+     unaligned reads.  */
+  sequential = (disk->ra_next && sector <= disk->ra_next
+		&& sector + 1 >= disk->ra_next);
+  disk->ra_next = end;
+  if (!sequential)
+    {
+      disk->ra_window = 0;
+      return;
+    }
+
+  start = sector & ~(GRUB_DISK_CACHE_SIZE - 1);
+  max = grub_disk_readahead_max >> (GRUB_DISK_CACHE_BITS
+				    + GRUB_DISK_SECTOR_BITS);
+  /* Large requests already stream at full speed.  */
+  if (((end - start) >> GRUB_DISK_CACHE_BITS) >= max)
+    return;
+  if (grub_disk_cache_lookup (disk->dev->id, disk->id, start))
+    return;
+  if (!disk->ra_window)
+    disk->ra_window = GRUB_DISK_READAHEAD_MIN;
+  else
+    disk->ra_window *= 2;
+  if (disk->ra_window > max)
+    disk->ra_window = max;
+
+  n = ((end - start + GRUB_DISK_CACHE_SIZE - 1) >> GRUB_DISK_CACHE_BITS)
+    + disk->ra_window;
+  if (disk->total_sectors != GRUB_DISK_SIZE_UNKNOWN)
+    {
+      grub_disk_addr_t total;
+
+      total = disk->total_sectors << (disk->log_sector_size
+				      - GRUB_DISK_SECTOR_BITS);
+      if (start + ((grub_disk_addr_t) n << GRUB_DISK_CACHE_BITS) > total)
+	n = (total - start) >> GRUB_DISK_CACHE_BITS;
+    }
+  if (!n)
+    return;
+
+  tmp_buf = grub_malloc (n << (GRUB_DISK_CACHE_BITS + GRUB_DISK_SECTOR_BITS));
+  if (!tmp_buf)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      disk->ra_window = 0;
+      return;
+    }
+
+  if ((disk->dev->read) (disk, transform_sector (disk, start),
+			 n << (GRUB_DISK_CACHE_BITS + GRUB_DISK_SECTOR_BITS
+			       - disk->log_sector_size), tmp_buf))
+    {
+      /* Leave it to the normal path to read and report errors.  */
+      grub_errno = GRUB_ERR_NONE;
+      disk->ra_window = 0;
+      grub_free (tmp_buf);
+      return;
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      grub_disk_addr_t s = start + (i << GRUB_DISK_CACHE_BITS);
+      if (!grub_disk_cache_lookup (disk->dev->id, disk->id, s))
+	grub_disk_cache_store (disk->dev->id, disk->id, s,
+			       tmp_buf + (i << (GRUB_DISK_CACHE_BITS
+						+ GRUB_DISK_SECTOR_BITS)));
+    }
+  grub_errno = GRUB_ERR_NONE;
+  grub_free (tmp_buf);
+}
+
 /* Read data from the disk.  */
 grub_err_t
 grub_disk_read (grub_disk_t disk, grub_disk_addr_t sector,
@@ -489,6 +700,8 @@ grub_disk_read (grub_disk_t disk, grub_disk_addr_t sector,
       return grub_errno;
     }
 
+  grub_disk_readahead (disk, sector, offset, size);
+
   real_sector = sector;
   real_offset = offset;
   real_size = size;
@@ -87,22 +87,23 @@ struct grub_symbol
 };
 typedef struct grub_symbol *grub_symbol_t;
 
-/* The size of the symbol table.  */
-#define GRUB_SYMTAB_SIZE	509
+/* The size of the symbol table.  Must be a power of 2.  */
+#define GRUB_SYMTAB_SIZE	512
 
 /* The symbol table (using an open-hash).  */
 static struct grub_symbol *grub_symtab[GRUB_SYMTAB_SIZE];
 
-/* Simple hash function.  */
+/* FNV-1a hash, folded to the table size with a mask rather than a
+   division.  It is computed for every relocation of every loaded module.  */
 static unsigned
 grub_symbol_hash (const char *s)
 {
-  unsigned key = 0;
+  grub_uint32_t key = 2166136261U;
 
   while (*s)
-    key = key * 65599 + *s++;
+    key = (key ^ (grub_uint8_t) *s++) * 16777619;
 
-  return (key + (key >> 5)) % GRUB_SYMTAB_SIZE;
+  return (key ^ (key >> 16)) & (GRUB_SYMTAB_SIZE - 1);
 }
 
 /* Resolve the symbol name NAME and return the address.
@@ -31,6 +31,48 @@
 grub_fs_t grub_fs_list = 0;
 
 grub_fs_autoload_hook_t grub_fs_autoload_hook = 0;
+grub_fs_autoload_device_hook_t grub_fs_autoload_device_hook = 0;
+
+/* Longest signature we check.  */
+#define GRUB_FS_SIGNATURE_MAX	16
+
+int
+grub_fs_check_signature (grub_disk_t disk, grub_uint64_t offset,
+			 const char *magic, grub_size_t size)
+{
+  char buf[GRUB_FS_SIGNATURE_MAX];
+
+  if (size > sizeof (buf))
+    return 1;
+
+  if (grub_disk_read (disk, offset >> GRUB_DISK_SECTOR_BITS,
+		      offset & (GRUB_DISK_SECTOR_SIZE - 1), size, buf))
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return 0;
+    }
+
+  return grub_memcmp (buf, magic, size) == 0;
+}
+
+/* Return nonzero if FS may be on DEVICE according to its signatures.  The
+   sectors involved are few and shared between filesystems, so they come
+   from the disk cache after the first check.  */
+static int
+signatures_match (grub_fs_t fs, grub_device_t device)
+{
+  const struct grub_fs_signature *sig;
+
+  if (!fs->signatures)
+    return 1;
+
+  for (sig = fs->signatures; sig->size; sig++)
+    if (grub_fs_check_signature (device->disk, sig->offset, sig->magic,
+				 sig->size))
+      return 1;
+
+  return 0;
+}
 
 /* Helper for grub_fs_probe.  */
 static int
@@ -41,6 +83,40 @@ probe_dummy_iter (const char *filename __attribute__ ((unused)),
   return 1;
 }
 
+/* Helper for grub_fs_probe.  Return GRUB_ERR_NONE if P recognizes
+   DEVICE.  */
+static grub_err_t
+try_fs (grub_fs_t p, grub_device_t device)
+{
+  grub_dprintf ("fs", "Detecting %s...\n", p->name);
+
+  /* This is evil: newly-created just mounted BtrFS after copying all
+     GRUB files has a very peculiar unrecoverable corruption which
+     will be fixed at sync but we'd rather not do a global sync and
+     syncing just files doesn't seem to help. Relax the check for
+     this time.  */
+#ifdef GRUB_UTIL
+  if (grub_strcmp (p->name, "btrfs") == 0)
+    {
+      char *label = 0;
+      p->uuid (device, &label);
+      if (label)
+	grub_free (label);
+    }
+  else
+#endif
+    (p->dir) (device, "/", probe_dummy_iter, NULL);
+
+  if (grub_errno)
+    {
+      grub_error_push ();
+      grub_dprintf ("fs", "%s detection failed.\n", p->name);
+      grub_error_pop ();
+    }
+
+  return grub_errno;
+}
+
 grub_fs_t
 grub_fs_probe (grub_device_t device)
 {
@@ -53,30 +129,14 @@ grub_fs_probe (grub_device_t device)
 
       for (p = grub_fs_list; p; p = p->next)
 	{
-	  grub_dprintf ("fs", "Detecting %s...\n", p->name);
-
-	  /* This is evil: newly-created just mounted BtrFS after copying all
-	     GRUB files has a very peculiar unrecoverable corruption which
-	     will be fixed at sync but we'd rather not do a global sync and
-	     syncing just files doesn't seem to help. Relax the check for
-	     this time.  */
-#ifdef GRUB_UTIL
-	  if (grub_strcmp (p->name, "btrfs") == 0)
+	  if (! signatures_match (p, device))
 	    {
-	      char *label = 0;
-	      p->uuid (device, &label);
-	      if (label)
-		grub_free (label);
+	      grub_dprintf ("fs", "%s signature not found.\n", p->name);
+	      continue;
 	    }
-	  else
-#endif
-	    (p->dir) (device, "/", probe_dummy_iter, NULL);
-	  if (grub_errno == GRUB_ERR_NONE)
-	    return p;
 
-	  grub_error_push ();
-	  grub_dprintf ("fs", "%s detection failed.\n", p->name);
-	  grub_error_pop ();
+	  if (try_fs (p, device) == GRUB_ERR_NONE)
+	    return p;
 
 	  if (grub_errno != GRUB_ERR_BAD_FS
 	      && grub_errno != GRUB_ERR_OUT_OF_RANGE)
@@ -85,17 +145,23 @@ grub_fs_probe (grub_device_t device)
 	  grub_errno = GRUB_ERR_NONE;
 	}
 
-      /* Let's load modules automatically.  */
-      if (grub_fs_autoload_hook && count == 0)
+      /* Let's load modules automatically.  Modules whose signatures
+	 match the device are loaded first, and are the only ones with
+	 signatures worth loading at all.  */
+      if (count == 0)
 	{
 	  count++;
 
-	  while (grub_fs_autoload_hook ())
+	  while ((grub_fs_autoload_device_hook
+		  && grub_fs_autoload_device_hook (device))
+		 || (grub_fs_autoload_hook && grub_fs_autoload_hook ()))
 	    {
 	      p = grub_fs_list;
 
-	      (p->dir) (device, "/", probe_dummy_iter, NULL);
-	      if (grub_errno == GRUB_ERR_NONE)
+	      if (! signatures_match (p, device))
+		continue;
+
+	      if (try_fs (p, device) == GRUB_ERR_NONE)
 		{
 		  count--;
 		  return p;
@@ -47,6 +47,7 @@ struct grub_crypto_hmac_handle
 
 static gcry_cipher_spec_t *grub_ciphers = NULL;
 static gcry_md_spec_t *grub_digests = NULL;
+static struct grub_crypto_cipher_accel *grub_cipher_accels = NULL;
 
 void (*grub_crypto_autoload_hook) (const char *name) = NULL;
 
@@ -113,6 +114,25 @@ grub_cipher_unregister (gcry_cipher_spec_t *cipher)
       }
 }
 
+void
+grub_crypto_cipher_accel_register (struct grub_crypto_cipher_accel *accel)
+{
+  accel->next = grub_cipher_accels;
+  grub_cipher_accels = accel;
+}
+
+void
+grub_crypto_cipher_accel_unregister (struct grub_crypto_cipher_accel *accel)
+{
+  struct grub_crypto_cipher_accel **p;
+  for (p = &grub_cipher_accels; *p; p = &((*p)->next))
+    if (*p == accel)
+      {
+	*p = (*p)->next;
+	break;
+      }
+}
+
 void 
 grub_md_register (gcry_md_spec_t *digest)
 {
@@ -188,14 +208,42 @@ grub_crypto_lookup_cipher_by_name (const char *name)
 }
 
 
+static const struct grub_crypto_cipher_accel *
+find_accel (const struct gcry_cipher_spec *cipher)
+{
+  const struct grub_crypto_cipher_accel *accel;
+  const char *const *name;
+
+  for (accel = grub_cipher_accels; accel; accel = accel->next)
+    for (name = accel->names; *name; name++)
+      if (grub_strcasecmp (cipher->name, *name) == 0)
+	return accel;
+  return NULL;
+}
+
+/* Bulk contexts are aligned for vector loads.  */
+#define ACCEL_ALIGN 16
+
 grub_crypto_cipher_handle_t
 grub_crypto_cipher_open (const struct gcry_cipher_spec *cipher)
 {
   grub_crypto_cipher_handle_t ret;
-  ret = grub_malloc (sizeof (*ret) + cipher->contextsize);
+  const struct grub_crypto_cipher_accel *accel;
+  grub_size_t size;
+
+  accel = find_accel (cipher);
+  size = sizeof (*ret) + cipher->contextsize;
+  if (accel)
+    size += accel->contextsize + ACCEL_ALIGN - 1;
+  ret = grub_malloc (size);
   if (!ret)
     return NULL;
   ret->cipher = cipher;
+  ret->accel = accel;
+  ret->accel_ctx = NULL;
+  if (accel)
+    ret->accel_ctx = (void *) ALIGN_UP ((grub_addr_t) ret->ctx
+					+ cipher->contextsize, ACCEL_ALIGN);
   return ret;
 }
 
@@ -204,7 +252,16 @@ grub_crypto_cipher_set_key (grub_crypto_cipher_handle_t cipher,
 			    const unsigned char *key,
 			    unsigned keylen)
 {
-  return cipher->cipher->setkey (cipher->ctx, key, keylen);
+  gcry_err_code_t err;
+
+  err = cipher->cipher->setkey (cipher->ctx, key, keylen);
+  if (err)
+    return err;
+  /* Fall back to the cipher spec for keys the bulk code can't handle.  */
+  if (cipher->accel
+      && cipher->accel->setkey (cipher->accel_ctx, key, keylen))
+    cipher->accel = NULL;
+  return GPG_ERR_NO_ERROR;
 }
 
 gcry_err_code_t
@@ -217,6 +274,12 @@ grub_crypto_ecb_decrypt (grub_crypto_cipher_handle_t cipher,
     return GPG_ERR_NOT_SUPPORTED;
   if (size % cipher->cipher->blocksize != 0)
     return GPG_ERR_INV_ARG;
+  if (cipher->accel)
+    {
+      cipher->accel->decrypt (cipher->accel_ctx, out, in,
+			      size / cipher->cipher->blocksize);
+      return GPG_ERR_NO_ERROR;
+    }
   end = (grub_uint8_t *) in + size;
   for (inptr = in, outptr = out; inptr < end;
        inptr += cipher->cipher->blocksize, outptr += cipher->cipher->blocksize)
@@ -234,6 +297,12 @@ grub_crypto_ecb_encrypt (grub_crypto_cipher_handle_t cipher,
     return GPG_ERR_NOT_SUPPORTED;
   if (size % cipher->cipher->blocksize != 0)
     return GPG_ERR_INV_ARG;
+  if (cipher->accel)
+    {
+      cipher->accel->encrypt (cipher->accel_ctx, out, in,
+			      size / cipher->cipher->blocksize);
+      return GPG_ERR_NO_ERROR;
+    }
   end = (grub_uint8_t *) in + size;
   for (inptr = in, outptr = out; inptr < end;
        inptr += cipher->cipher->blocksize, outptr += cipher->cipher->blocksize)
@@ -265,6 +334,9 @@ grub_crypto_cbc_encrypt (grub_crypto_cipher_handle_t cipher,
   return GPG_ERR_NO_ERROR;
 }
 
+/* The amount of data decrypted at once by bulk CBC decryption.  */
+#define CBC_CHUNK 512
+
 gcry_err_code_t
 grub_crypto_cbc_decrypt (grub_crypto_cipher_handle_t cipher,
 			 void *out, const void *in, grub_size_t size,
@@ -277,6 +349,32 @@ grub_crypto_cbc_decrypt (grub_crypto_cipher_handle_t cipher,
     return GPG_ERR_NOT_SUPPORTED;
   if (size % cipher->cipher->blocksize != 0)
     return GPG_ERR_INV_ARG;
+  if (cipher->accel)
+    {
+      grub_size_t bs = cipher->cipher->blocksize;
+      grub_uint8_t buf[CBC_CHUNK];
+
+      /* All blocks of a chunk are decrypted at once, so keep a copy of
+	 the ciphertext for chaining in case OUT and IN are the same.  */
+      inptr = in;
+      outptr = out;
+      while (size)
+	{
+	  grub_size_t chunk = size < sizeof (buf) ? size
+	    : sizeof (buf) - sizeof (buf) % bs;
+
+	  grub_memcpy (buf, inptr, chunk);
+	  cipher->accel->decrypt (cipher->accel_ctx, outptr, buf,
+				  chunk / bs);
+	  grub_crypto_xor (outptr, outptr, iv, bs);
+	  grub_crypto_xor (outptr + bs, outptr + bs, buf, chunk - bs);
+	  grub_memcpy (iv, buf + chunk - bs, bs);
+	  inptr += chunk;
+	  outptr += chunk;
+	  size -= chunk;
+	}
+      return GPG_ERR_NO_ERROR;
+    }
   end = (grub_uint8_t *) in + size;
   for (inptr = in, outptr = out; inptr < end;
        inptr += cipher->cipher->blocksize, outptr += cipher->cipher->blocksize)
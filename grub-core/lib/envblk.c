@@ -22,6 +22,9 @@
 #include <grub/misc.h>
 #include <grub/mm.h>
 #include <grub/lib/envblk.h>
+#include <grub/dl.h>
+
+GRUB_MOD_LICENSE ("GPLv3+");
 
 grub_envblk_t
 grub_envblk_open (char *buf, grub_size_t size)
@@ -0,0 +1,175 @@
+/* gf256.c - GF(2^8) region multiplication for RAID6 and raidz.  */
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grub/gf256.h>
+#include <grub/misc.h>
+#include <grub/dl.h>
+
+GRUB_MOD_LICENSE ("GPLv3+");
+
+/* SSE registers are only known to be usable on 64-bit EFI.  */
+#if defined (__x86_64__) && defined (GRUB_MACHINE_EFI)
+#define GF256_SSSE3 1
+#endif
+
+grub_uint8_t grub_gf256_powx[255 * 2];
+int grub_gf256_powx_inv[256];
+int grub_gf256_simd;
+
+static const grub_uint8_t poly = 0x1d;
+
+#ifdef GF256_SSSE3
+/* TABLES holds the products of C with the 16 low nibbles followed by
+   the products with the 16 high nibbles.  NBLOCKS is in 16-byte
+   units.  */
+void grub_gf256_ssse3_mul (const grub_uint8_t *tables, grub_uint8_t *dst,
+			   const grub_uint8_t *src, grub_size_t nblocks);
+void grub_gf256_ssse3_mul_xor (const grub_uint8_t *tables, grub_uint8_t *dst,
+			       const grub_uint8_t *src, grub_size_t nblocks);
+
+static int
+ssse3_supported (void)
+{
+  grub_uint32_t eax = 1, ebx, ecx = 0, edx;
+
+  asm volatile ("cpuid"
+		: "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+  return !!(ecx & (1 << 9));
+}
+#endif
+
+void
+grub_gf256_init (void)
+{
+  grub_uint8_t cur = 1;
+  int i;
+
+  if (grub_gf256_powx[0])
+    return;
+
+  for (i = 0; i < 255; i++)
+    {
+      grub_gf256_powx[i] = cur;
+      grub_gf256_powx[i + 255] = cur;
+      grub_gf256_powx_inv[cur] = i;
+      if (cur & 0x80)
+	cur = (cur << 1) ^ poly;
+      else
+	cur <<= 1;
+    }
+
+#ifdef GF256_SSSE3
+  grub_gf256_simd = ssse3_supported ();
+#endif
+}
+
+void
+grub_gf256_mul_region_table (grub_uint8_t *dst, const grub_uint8_t *src,
+			     grub_size_t size, grub_uint8_t c)
+{
+  for (; size; size--, src++, dst++)
+    *dst = grub_gf256_mul (*src, c);
+}
+
+void
+grub_gf256_mul_xor_region_table (grub_uint8_t *dst, const grub_uint8_t *src,
+				 grub_size_t size, grub_uint8_t c)
+{
+  for (; size; size--, src++, dst++)
+    *dst ^= grub_gf256_mul (*src, c);
+}
+
+/* Below this size building the product table costs more than it saves.  */
+#define GF256_TABLE_MIN 64
+
+static void
+mul_region (grub_uint8_t *dst, const grub_uint8_t *src,
+	    grub_size_t size, grub_uint8_t c, int accumulate)
+{
+  grub_uint8_t products[256];
+  unsigned i;
+
+#ifdef GF256_SSSE3
+  if (grub_gf256_simd && size >= 16)
+    {
+      for (i = 0; i < 16; i++)
+	{
+	  products[i] = grub_gf256_mul (i, c);
+	  products[i + 16] = grub_gf256_mul (i << 4, c);
+	}
+      if (accumulate)
+	grub_gf256_ssse3_mul_xor (products, dst, src, size >> 4);
+      else
+	grub_gf256_ssse3_mul (products, dst, src, size >> 4);
+      dst += size & ~(grub_size_t) 15;
+      src += size & ~(grub_size_t) 15;
+      size &= 15;
+    }
+#endif
+
+  if (size < GF256_TABLE_MIN)
+    {
+      if (accumulate)
+	grub_gf256_mul_xor_region_table (dst, src, size, c);
+      else
+	grub_gf256_mul_region_table (dst, src, size, c);
+      return;
+    }
+
+  /* Tabulate all products with C, using linearity: the product of I is
+     that of I without its lowest set bit xored with that of the bit.  */
+  products[0] = 0;
+  products[1] = c;
+  for (i = 2; i < 256; i++)
+    if (i & (i - 1))
+      products[i] = products[i & (i - 1)] ^ products[i & -i];
+    else
+      products[i] = (products[i >> 1] << 1)
+	^ ((products[i >> 1] & 0x80) ? poly : 0);
+
+  if (accumulate)
+    for (; size; size--, src++, dst++)
+      *dst ^= products[*src];
+  else
+    for (; size; size--, src++, dst++)
+      *dst = products[*src];
+}
+
+void
+grub_gf256_mul_region (grub_uint8_t *dst, const grub_uint8_t *src,
+		       grub_size_t size, grub_uint8_t c)
+{
+  if (c == 0)
+    grub_memset (dst, 0, size);
+  else if (c == 1)
+    {
+      if (dst != src)
+	grub_memmove (dst, src, size);
+    }
+  else
+    mul_region (dst, src, size, c, 0);
+}
+
+void
+grub_gf256_mul_xor_region (grub_uint8_t *dst, const grub_uint8_t *src,
+			   grub_size_t size, grub_uint8_t c)
+{
+  if (c != 0)
+    mul_region (dst, src, size, c, 1);
+}
@@ -33,6 +33,10 @@ GRUB_MOD_LICENSE ("GPLv2+");
    be filled with the derived data.  */
 #pragma GCC diagnostic ignored "-Wunreachable-code"
 
+/* The HMAC key only affects the hash states after the inner and outer
+   pads are absorbed, so those two states are computed once and copied
+   for every iteration instead of re-keying HMAC each time.  This halves
+   the number of compressions per iteration.  */
 gcry_err_code_t
 grub_crypto_pbkdf2 (const struct gcry_md_spec *md,
 		    const grub_uint8_t *P, grub_size_t Plen,
@@ -43,14 +47,16 @@ grub_crypto_pbkdf2 (const struct gcry_md_spec *md,
   unsigned int hLen = md->mdlen;
   grub_uint8_t U[md->mdlen];
   grub_uint8_t T[md->mdlen];
+  grub_uint8_t key[md->mdlen];
+  grub_uint8_t pad[md->blocksize];
+  grub_size_t ctxsize = ALIGN_UP (md->contextsize, 16);
+  grub_uint8_t *states, *inner, *outer, *ictx, *octx;
   unsigned int u;
   unsigned int l;
   unsigned int r;
   unsigned int i;
   unsigned int k;
-  gcry_err_code_t rc;
-  grub_uint8_t *tmp;
-  grub_size_t tmplen = Slen + 4;
+  grub_uint8_t cnt[4];
 
   if (c == 0)
     return GPG_ERR_INV_ARG;
@@ -61,47 +67,78 @@ grub_crypto_pbkdf2 (const struct gcry_md_spec *md,
   if (dkLen > 4294967295U)
     return GPG_ERR_INV_ARG;
 
+  if (md->mdlen > md->blocksize)
+    return GPG_ERR_INV_ARG;
+
   l = ((dkLen - 1) / hLen) + 1;
   r = dkLen - (l - 1) * hLen;
 
-  tmp = grub_malloc (tmplen);
-  if (tmp == NULL)
+  states = grub_malloc (4 * ctxsize);
+  if (states == NULL)
     return GPG_ERR_OUT_OF_MEMORY;
+  inner = states;
+  outer = states + ctxsize;
+  ictx = states + 2 * ctxsize;
+  octx = states + 3 * ctxsize;
+
+  if (Plen > md->blocksize)
+    {
+      grub_crypto_hash (md, key, P, Plen);
+      P = key;
+      Plen = hLen;
+    }
 
-  grub_memcpy (tmp, S, Slen);
+  grub_memset (pad, 0, md->blocksize);
+  grub_memcpy (pad, P, Plen);
+  for (k = 0; k < md->blocksize; k++)
+    pad[k] ^= 0x36;
+  md->init (inner);
+  md->write (inner, pad, md->blocksize);
+  for (k = 0; k < md->blocksize; k++)
+    pad[k] ^= 0x36 ^ 0x5c;
+  md->init (outer);
+  md->write (outer, pad, md->blocksize);
 
   for (i = 1; i - 1 < l; i++)
     {
-      grub_memset (T, 0, hLen);
+      cnt[0] = (i & 0xff000000) >> 24;
+      cnt[1] = (i & 0x00ff0000) >> 16;
+      cnt[2] = (i & 0x0000ff00) >> 8;
+      cnt[3] = (i & 0x000000ff) >> 0;
 
       for (u = 0; u < c; u++)
 	{
+	  grub_memcpy (ictx, inner, md->contextsize);
 	  if (u == 0)
 	    {
-	      tmp[Slen + 0] = (i & 0xff000000) >> 24;
-	      tmp[Slen + 1] = (i & 0x00ff0000) >> 16;
-	      tmp[Slen + 2] = (i & 0x0000ff00) >> 8;
-	      tmp[Slen + 3] = (i & 0x000000ff) >> 0;
-
-	      rc = grub_crypto_hmac_buffer (md, P, Plen, tmp, tmplen, U);
+	      md->write (ictx, S, Slen);
+	      md->write (ictx, cnt, sizeof (cnt));
 	    }
 	  else
-	    rc = grub_crypto_hmac_buffer (md, P, Plen, U, hLen, U);
+	    md->write (ictx, U, hLen);
+	  md->final (ictx);
 
-	  if (rc != GPG_ERR_NO_ERROR)
-	    {
-	      grub_free (tmp);
-	      return rc;
-	    }
+	  grub_memcpy (octx, outer, md->contextsize);
+	  md->write (octx, md->read (ictx), hLen);
+	  md->final (octx);
+	  grub_memcpy (U, md->read (octx), hLen);
 
-	  for (k = 0; k < hLen; k++)
-	    T[k] ^= U[k];
+	  if (u == 0)
+	    grub_memcpy (T, U, hLen);
+	  else
+	    grub_crypto_xor (T, T, U, hLen);
 	}
 
       grub_memcpy (DK + (i - 1) * hLen, T, i == l ? r : hLen);
     }
 
-  grub_free (tmp);
+  /* The states are as good as the password.  */
+  grub_memset (states, 0, 4 * ctxsize);
+  grub_memset (pad, 0, md->blocksize);
+  grub_memset (key, 0, hLen);
+  grub_memset (U, 0, hLen);
+  grub_memset (T, 0, hLen);
+  grub_free (states);
 
   return GPG_ERR_NO_ERROR;
 }
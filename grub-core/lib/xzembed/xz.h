@@ -177,6 +177,16 @@ enum xz_ret xz_dec_run(struct xz_dec *s, struct xz_buf *b);
  */
 void xz_dec_reset(struct xz_dec *s);
 
+/**
+ * xz_dec_past_blocks() - Tell whether all Blocks have been decoded
+ * @s:          Decoder state allocated using xz_dec_init()
+ *
+ * Returns true once the decoder has verified the Check of the last Block
+ * and moved on to the Index or the Stream Footer. An error returned by
+ * xz_dec_run() in this state concerns only the Index and the footer.
+ */
+bool xz_dec_past_blocks(const struct xz_dec *s);
+
 /**
  * xz_dec_end() - Free the memory allocated for the decoder state
  * @s:          Decoder state allocated using xz_dec_init(). If s is NULL,
@@ -1026,6 +1026,11 @@ void xz_dec_reset(struct xz_dec *s)
 	s->have_hash_value = 0;
 }
 
+bool xz_dec_past_blocks(const struct xz_dec *s)
+{
+	return s->sequence >= SEQ_INDEX;
+}
+
 void xz_dec_end(struct xz_dec *s)
 {
 	if (s != NULL) {
@@ -84,42 +84,42 @@ get_card_packet (struct grub_net_card *dev)
   grub_efi_simple_network_t *net = dev->efi_net;
   grub_err_t err;
   grub_efi_status_t st;
-  grub_efi_uintn_t bufsize = dev->rcvbufsize;
-  struct grub_net_buff *nb;
+  grub_efi_uintn_t bufsize;
+  struct grub_net_buff *nb = NULL;
   int i;
 
+  /* Let the firmware write the frame straight into the packet buffer.  */
   for (i = 0; i < 2; i++)
     {
-      if (!dev->rcvbuf)
-	dev->rcvbuf = grub_malloc (dev->rcvbufsize);
-      if (!dev->rcvbuf)
+      nb = grub_netbuff_pool_alloc (dev->rx_pool, dev->rcvbufsize + 2);
+      if (!nb)
 	return NULL;
 
+      /* Reserve 2 bytes so that 2 + 14/18 bytes of ethernet header is
+	 divisible by 4. So that IP header is aligned on 4 bytes. */
+      if (grub_netbuff_reserve (nb, 2))
+	{
+	  grub_netbuff_free (nb);
+	  return NULL;
+	}
+
+      bufsize = dev->rcvbufsize;
       st = efi_call_7 (net->receive, net, NULL, &bufsize,
-		       dev->rcvbuf, NULL, NULL, NULL);
+		       nb->data, NULL, NULL, NULL);
       if (st != GRUB_EFI_BUFFER_TOO_SMALL)
 	break;
+      grub_netbuff_free (nb);
+      nb = NULL;
       dev->rcvbufsize = 2 * ALIGN_UP (dev->rcvbufsize > bufsize
 				      ? dev->rcvbufsize : bufsize, 64);
-      grub_free (dev->rcvbuf);
-      dev->rcvbuf = 0;
     }
 
   if (st != GRUB_EFI_SUCCESS)
-    return NULL;
-
-  nb = grub_netbuff_alloc (bufsize + 2);
-  if (!nb)
-    return NULL;
-
-  /* Reserve 2 bytes so that 2 + 14/18 bytes of ethernet header is divisible
-     by 4. So that IP header is aligned on 4 bytes. */
-  if (grub_netbuff_reserve (nb, 2))
     {
       grub_netbuff_free (nb);
       return NULL;
     }
-  grub_memcpy (nb->data, dev->rcvbuf, bufsize);
+
   err = grub_netbuff_put (nb, bufsize);
   if (err)
     {
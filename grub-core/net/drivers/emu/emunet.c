@@ -49,12 +49,12 @@ send_card_buffer (struct grub_net_card *dev __attribute__ ((unused)),
 }
 
 static struct grub_net_buff *
-get_card_packet (struct grub_net_card *dev __attribute__ ((unused)))
+get_card_packet (struct grub_net_card *dev)
 {
   ssize_t actual;
   struct grub_net_buff *nb;
 
-  nb = grub_netbuff_alloc (1536 + 2);
+  nb = grub_netbuff_pool_alloc (dev->rx_pool, 1536 + 2);
   if (!nb)
     return NULL;
 
@@ -71,7 +71,7 @@ get_card_packet (struct grub_net_card *dev)
   struct grub_net_buff *nb;
   int actual;
 
-  nb = grub_netbuff_alloc (dev->mtu + 64 + 2);
+  nb = grub_netbuff_pool_alloc (dev->rx_pool, dev->mtu + 64 + 2);
   if (!nb)
     return NULL;
   /* Reserve 2 bytes so that 2 + 14/18 bytes of ethernet header is divisible
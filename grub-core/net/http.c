@@ -26,6 +26,8 @@
 #include <grub/dl.h>
 #include <grub/file.h>
 #include <grub/i18n.h>
+#include <grub/env.h>
+#include <grub/list.h>
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
@@ -34,6 +36,24 @@ enum
     HTTP_PORT = 80
   };
 
+/* Idle keep-alive connections kept for reuse.  */
+#define HTTP_MAX_IDLE_CONNS 4
+/* On a seek, an open-ended response with at most this much left is read
+   and thrown away, which is cheaper than a new connection.  */
+#define HTTP_DRAIN_LIMIT 65536
+#define HTTP_MIN_RANGE_SIZE 4096
+
+/* A connection to a server.  It is the hook data of its socket, so it
+   stays valid while the connection passes from file to file.  */
+struct http_conn
+{
+  struct http_conn *next;
+  struct http_conn **prev;
+  char *server;
+  grub_net_tcp_socket_t sock;
+  /* File whose requests are in flight, NULL while idle.  */
+  grub_file_t file;
+};
 
 typedef struct http_data
 {
@@ -42,15 +62,39 @@ typedef struct http_data
   int headers_recv;
   int first_line_recv;
   int size_recv;
-  grub_net_tcp_socket_t sock;
+  struct http_conn *conn;
   char *filename;
   grub_err_t err;
   char *errmsg;
   int chunked;
   grub_size_t chunk_rem;
   int in_chunk_len;
+  int status;
+  int have_length;
+  grub_off_t body_rem;
+  /* The server may reuse the connection.  */
+  int keep_alive;
+  /* Requests sent whose responses are not complete, and how many of the
+     oldest of them are read only to be thrown away.  */
+  int in_flight;
+  int discard;
+  /* Headers of the response the reader waits for were received.  */
+  int response_ready;
+  /* Offset of the next byte of the file to be received.  */
+  grub_off_t recv_offset;
+  /* Size of the ranges requested in readahead mode, or 0.  */
+  grub_off_t range_size;
+  grub_off_t next_offset;
+  /* Reconnect from recv_offset when the reader next pulls packets.  */
+  int resume;
+  grub_off_t resume_offset;
 } *http_data_t;
 
+static struct http_conn *http_idle_conns;
+
+static grub_err_t
+http_request (struct grub_file *file, grub_off_t offset, int *reused);
+
 static grub_off_t
 have_ahead (struct grub_file *file)
 {
@@ -62,6 +106,97 @@ have_ahead (struct grub_file *file)
   return ret;
 }
 
+static void
+http_conn_drop (struct http_conn *conn)
+{
+  grub_net_tcp_close (conn->sock, GRUB_NET_TCP_ABORT);
+  grub_free (conn->server);
+  grub_free (conn);
+}
+
+/* Detach the connection from DATA.  It is kept for reuse if it is
+   between two responses and the server agreed to keep it.  */
+static void
+http_release (http_data_t data)
+{
+  struct http_conn *conn = data->conn, *c, *next;
+  int n = 0;
+
+  if (!conn)
+    return;
+  data->conn = 0;
+
+  if (data->in_flight || !data->keep_alive)
+    {
+      http_conn_drop (conn);
+      return;
+    }
+
+  conn->file = 0;
+  grub_net_tcp_unstall (conn->sock);
+  grub_list_push (GRUB_AS_LIST_P (&http_idle_conns), GRUB_AS_LIST (conn));
+  FOR_LIST_ELEMENTS_SAFE (c, next, http_idle_conns)
+    if (++n > HTTP_MAX_IDLE_CONNS)
+      {
+	grub_list_remove (GRUB_AS_LIST (c));
+	http_conn_drop (c);
+      }
+}
+
+static void
+http_reset_response (http_data_t data)
+{
+  grub_free (data->current_line);
+  data->current_line = 0;
+  data->current_line_len = 0;
+  data->headers_recv = 0;
+  data->first_line_recv = 0;
+  data->chunked = 0;
+  data->chunk_rem = 0;
+  data->in_chunk_len = 0;
+  data->status = 0;
+  data->have_length = 0;
+  data->body_rem = 0;
+}
+
+static void
+http_response_done (grub_file_t file, http_data_t data)
+{
+  int discarded = data->discard;
+
+  http_reset_response (data);
+  data->in_flight--;
+  if (data->discard)
+    data->discard--;
+  if (discarded || data->in_flight)
+    return;
+
+  if (data->range_size && file->size != GRUB_FILE_SIZE_UNKNOWN
+      && data->recv_offset < file->size)
+    {
+      if (data->keep_alive)
+	{
+	  if (http_request (file, data->recv_offset, 0))
+	    {
+	      grub_errno = GRUB_ERR_NONE;
+	      http_release (data);
+	      data->resume = 1;
+	    }
+	  return;
+	}
+      http_release (data);
+      data->resume = 1;
+      return;
+    }
+
+  file->device->net->eof = 1;
+  file->device->net->stall = 1;
+  if (file->size == GRUB_FILE_SIZE_UNKNOWN)
+    file->size = have_ahead (file);
+  if (!data->keep_alive)
+    http_release (data);
+}
+
 static grub_err_t
 parse_line (grub_file_t file, http_data_t data, char *ptr, grub_size_t len)
 {
@@ -79,37 +214,61 @@ parse_line (grub_file_t file, http_data_t data, char *ptr, grub_size_t len)
     {
       data->chunk_rem = grub_strtoul (ptr, 0, 16);
       grub_errno = GRUB_ERR_NONE;
-      if (data->chunk_rem == 0)
-	{
-	  file->device->net->eof = 1;
-	  file->device->net->stall = 1;
-	  if (file->size == GRUB_FILE_SIZE_UNKNOWN)
-	    file->size = have_ahead (file);
-	}
-      data->in_chunk_len = 0;
+      /* The last chunk is followed by trailer lines.  */
+      data->in_chunk_len = data->chunk_rem ? 0 : 3;
+      return GRUB_ERR_NONE;
+    }
+  if (data->in_chunk_len == 3)
+    {
+      if (ptr == end)
+	http_response_done (file, data);
       return GRUB_ERR_NONE;
     }
   if (ptr == end)
     {
       data->headers_recv = 1;
+      if (!data->discard)
+	{
+	  data->response_ready = 1;
+	  /* The server ignored the range and sends the whole file.  */
+	  if (data->status == 200)
+	    data->range_size = 0;
+	  /* Pipeline the next range behind this one.  */
+	  if (data->status == 206 && data->range_size && data->keep_alive
+	      && data->in_flight == 1 && file->size != GRUB_FILE_SIZE_UNKNOWN
+	      && data->next_offset < file->size
+	      && http_request (file, data->next_offset, 0))
+	    grub_errno = GRUB_ERR_NONE;
+	}
       if (data->chunked)
 	data->in_chunk_len = 2;
+      else if (data->have_length && data->body_rem == 0)
+	http_response_done (file, data);
       return GRUB_ERR_NONE;
     }
 
   if (!data->first_line_recv)
     {
       int code;
-      if (grub_memcmp (ptr, "HTTP/1.1 ", sizeof ("HTTP/1.1 ") - 1) != 0)
+      data->first_line_recv = 1;
+      if (grub_memcmp (ptr, "HTTP/1.0 ", sizeof ("HTTP/1.0 ") - 1) == 0)
+	data->keep_alive = 0;
+      else if (grub_memcmp (ptr, "HTTP/1.1 ", sizeof ("HTTP/1.1 ") - 1) != 0)
 	{
-	  data->errmsg = grub_strdup (_("unsupported HTTP response"));
-	  data->first_line_recv = 1;
+	  if (!data->discard && !data->err)
+	    {
+	      data->err = GRUB_ERR_NET_UNKNOWN_ERROR;
+	      data->errmsg = grub_strdup (_("unsupported HTTP response"));
+	    }
 	  return GRUB_ERR_NONE;
 	}
       ptr += sizeof ("HTTP/1.1 ") - 1;
       code = grub_strtoul (ptr, &ptr, 10);
       if (grub_errno)
 	return grub_errno;
+      data->status = code;
+      if (data->discard || data->err)
+	return GRUB_ERR_NONE;
       switch (code)
 	{
 	case 200:
@@ -127,15 +286,36 @@ parse_line (grub_file_t file, http_data_t data, char *ptr, grub_size_t len)
 					 code, ptr);
 	  return GRUB_ERR_NONE;
 	}
-      data->first_line_recv = 1;
       return GRUB_ERR_NONE;
     }
   if (grub_memcmp (ptr, "Content-Length: ", sizeof ("Content-Length: ") - 1)
-      == 0 && !data->size_recv)
+      == 0)
     {
       ptr += sizeof ("Content-Length: ") - 1;
-      file->size = grub_strtoull (ptr, &ptr, 10);
-      data->size_recv = 1;
+      data->body_rem = grub_strtoull (ptr, &ptr, 10);
+      data->have_length = 1;
+      if (!data->size_recv && !data->discard && data->status == 200)
+	{
+	  file->size = data->body_rem;
+	  data->size_recv = 1;
+	}
+      return GRUB_ERR_NONE;
+    }
+  if (grub_memcmp (ptr, "Content-Range: bytes ",
+		   sizeof ("Content-Range: bytes ") - 1) == 0)
+    {
+      ptr = grub_strchr (ptr, '/');
+      if (ptr && ptr[1] != '*' && !data->size_recv && !data->discard)
+	{
+	  file->size = grub_strtoull (ptr + 1, 0, 10);
+	  data->size_recv = 1;
+	}
+      return GRUB_ERR_NONE;
+    }
+  if (grub_memcmp (ptr, "Connection: close",
+		   sizeof ("Connection: close") - 1) == 0)
+    {
+      data->keep_alive = 0;
       return GRUB_ERR_NONE;
     }
   if (grub_memcmp (ptr, "Transfer-Encoding: chunked",
@@ -150,41 +330,98 @@ parse_line (grub_file_t file, http_data_t data, char *ptr, grub_size_t len)
 
 static void
 http_err (grub_net_tcp_socket_t sock __attribute__ ((unused)),
-	  void *f)
+	  void *c)
 {
-  grub_file_t file = f;
-  http_data_t data = file->data;
+  struct http_conn *conn = c;
+  grub_file_t file = conn->file;
+  http_data_t data;
 
-  if (data->sock)
-    grub_net_tcp_close (data->sock, GRUB_NET_TCP_ABORT);
-  data->sock = 0;
+  if (!file)
+    {
+      grub_list_remove (GRUB_AS_LIST (conn));
+      http_conn_drop (conn);
+      return;
+    }
+
+  data = file->data;
+  data->conn = 0;
+  http_conn_drop (conn);
   if (data->current_line)
     grub_free (data->current_line);
   data->current_line = 0;
+
+  /* A connection closed in the middle of a file of known size is
+     resumed, as long as the previous attempt made progress.  */
+  if (file->size != GRUB_FILE_SIZE_UNKNOWN && data->response_ready
+      && !data->err && data->recv_offset < file->size
+      && data->recv_offset > data->resume_offset)
+    {
+      http_reset_response (data);
+      data->in_flight = 0;
+      data->discard = 0;
+      data->resume = 1;
+      return;
+    }
+
   file->device->net->eof = 1;
   file->device->net->stall = 1;
   if (file->size == GRUB_FILE_SIZE_UNKNOWN)
     file->size = have_ahead (file);
 }
 
+/* Queue NB, which holds the next body bytes of the current response.  */
+static void
+http_deliver (grub_file_t file, http_data_t data, struct grub_net_buff *nb)
+{
+  if (data->discard || data->err)
+    {
+      grub_netbuff_free (nb);
+      return;
+    }
+  data->recv_offset += nb->tail - nb->data;
+  grub_net_put_packet (&file->device->net->packs, nb);
+  if (file->device->net->packs.count >= 20)
+    file->device->net->stall = 1;
+
+  if (file->device->net->packs.count >= 100 && data->conn)
+    grub_net_tcp_stall (data->conn->sock);
+}
+
 static grub_err_t
 http_receive (grub_net_tcp_socket_t sock __attribute__ ((unused)),
 	      struct grub_net_buff *nb,
-	      void *f)
+	      void *c)
 {
-  grub_file_t file = f;
-  http_data_t data = file->data;
+  struct http_conn *conn = c;
+  grub_file_t file = conn->file;
+  http_data_t data;
   grub_err_t err;
 
-  if (!data->sock)
+  /* Nothing was requested on an idle connection.  */
+  if (!file)
     {
       grub_netbuff_free (nb);
+      grub_list_remove (GRUB_AS_LIST (conn));
+      http_conn_drop (conn);
       return GRUB_ERR_NONE;
     }
+  data = file->data;
 
   while (1)
     {
       char *ptr = (char *) nb->data;
+      grub_size_t len;
+      /* The body can be larger than a grub_size_t.  */
+      grub_off_t rem;
+      int in_flight = data->in_flight;
+
+      /* Nothing is expected, or the connection was given up.  */
+      if (!data->in_flight || data->conn != conn)
+	{
+	  grub_netbuff_free (nb);
+	  return GRUB_ERR_NONE;
+	}
+
       if ((!data->headers_recv || data->in_chunk_len) && data->current_line)
 	{
 	  int have_line = 1;
@@ -202,7 +439,7 @@ http_receive (grub_net_tcp_socket_t sock __attribute__ ((unused)),
 	  if (!t)
 	    {
 	      grub_netbuff_free (nb);
-	      grub_net_tcp_close (data->sock, GRUB_NET_TCP_ABORT);
+	      http_release (data);
 	      return grub_errno;
 	    }
 	      
@@ -215,17 +452,21 @@ http_receive (grub_net_tcp_socket_t sock __attribute__ ((unused)),
 	      grub_netbuff_free (nb);
 	      return GRUB_ERR_NONE;
 	    }
-	  err = parse_line (file, data, data->current_line,
-			    data->current_line_len);
-	  grub_free (data->current_line);
+	  t = data->current_line;
 	  data->current_line = 0;
+	  /* Leave out the newline, whose place takes the terminating NUL.  */
+	  err = parse_line (file, data, t, data->current_line_len - 1);
+	  grub_free (t);
 	  data->current_line_len = 0;
+	  if (!err)
+	    err = grub_netbuff_pull (nb, ptr - (char *) nb->data);
 	  if (err)
 	    {
-	      grub_net_tcp_close (data->sock, GRUB_NET_TCP_ABORT);
+	      http_release (data);
 	      grub_netbuff_free (nb);
 	      return err;
 	    }
+	  continue;
 	}
 
       while (ptr < (char *) nb->tail && (!data->headers_recv
@@ -239,7 +480,7 @@ http_receive (grub_net_tcp_socket_t sock __attribute__ ((unused)),
 	      if (!data->current_line)
 		{
 		  grub_netbuff_free (nb);
-		  grub_net_tcp_close (data->sock, GRUB_NET_TCP_ABORT);
+		  http_release (data);
 		  return grub_errno;
 		}
 	      data->current_line_len = (char *) nb->tail - ptr;
@@ -250,11 +491,14 @@ http_receive (grub_net_tcp_socket_t sock __attribute__ ((unused)),
 	  err = parse_line (file, data, ptr, ptr2 - ptr);
 	  if (err)
 	    {
-	      grub_net_tcp_close (data->sock, GRUB_NET_TCP_ABORT);
+	      http_release (data);
 	      grub_netbuff_free (nb);
 	      return err;
 	    }
 	  ptr = ptr2 + 1;
+	  /* The line completed a response or sent a request.  */
+	  if (data->in_flight != in_flight)
+	    break;
 	}
 
       if (((char *) nb->tail - ptr) <= 0)
@@ -265,63 +509,98 @@ http_receive (grub_net_tcp_socket_t sock __attribute__ ((unused)),
       err = grub_netbuff_pull (nb, ptr - (char *) nb->data);
       if (err)
 	{
-	  grub_net_tcp_close (data->sock, GRUB_NET_TCP_ABORT);
+	  http_release (data);
 	  grub_netbuff_free (nb);
 	  return err;
 	}
-      if (!(data->chunked && (grub_ssize_t) data->chunk_rem
-	    < nb->tail - nb->data))
-	{
-	  grub_net_put_packet (&file->device->net->packs, nb);
-	  if (file->device->net->packs.count >= 20)
-	    file->device->net->stall = 1;
+      if (!data->headers_recv || data->in_chunk_len)
+	continue;
 
-	  if (file->device->net->packs.count >= 100)
-	    grub_net_tcp_stall (data->sock);
+      len = nb->tail - nb->data;
+      if (data->chunked)
+	rem = data->chunk_rem;
+      else if (data->have_length)
+	rem = data->body_rem;
+      else
+	rem = len;
 
+      if (len <= rem)
+	{
+	  http_deliver (file, data, nb);
 	  if (data->chunked)
-	    data->chunk_rem -= nb->tail - nb->data;
+	    {
+	      data->chunk_rem -= len;
+	      if (!data->chunk_rem)
+		data->in_chunk_len = 1;
+	    }
+	  else if (data->have_length)
+	    {
+	      data->body_rem -= len;
+	      if (!data->body_rem)
+		http_response_done (file, data);
+	    }
 	  return GRUB_ERR_NONE;
 	}
-      if (data->chunk_rem)
+
+      /* The packet holds the end of a chunk or of the response, and what
+	 follows it.  */
+      if (rem)
 	{
 	  struct grub_net_buff *nb2;
-	  nb2 = grub_netbuff_alloc (data->chunk_rem);
+	  nb2 = grub_netbuff_alloc (rem);
 	  if (!nb2)
-	    return grub_errno;
-	  grub_netbuff_put (nb2, data->chunk_rem);
-	  grub_memcpy (nb2->data, nb->data, data->chunk_rem);
-	  if (file->device->net->packs.count >= 20)
 	    {
-	      file->device->net->stall = 1;
-	      grub_net_tcp_stall (data->sock);
+	      grub_netbuff_free (nb);
+	      return grub_errno;
 	    }
-
-	  grub_net_put_packet (&file->device->net->packs, nb2);
-	  grub_netbuff_pull (nb, data->chunk_rem);
+	  grub_netbuff_put (nb2, rem);
+	  grub_memcpy (nb2->data, nb->data, rem);
+	  http_deliver (file, data, nb2);
+	  grub_netbuff_pull (nb, rem);
+	}
+      if (data->chunked)
+	{
+	  data->chunk_rem = 0;
+	  data->in_chunk_len = 1;
+	}
+      else
+	{
+	  data->body_rem = 0;
+	  http_response_done (file, data);
 	}
-      data->in_chunk_len = 1;
     }
 }
 
+/* Send a GET for the file from OFFSET, on the connection of FILE, an idle
+   one to the same server or a new one.  In readahead mode only
+   range_size bytes are requested.  */
 static grub_err_t
-http_establish (struct grub_file *file, grub_off_t offset, int initial)
+http_request (struct grub_file *file, grub_off_t offset, int *reused)
 {
   http_data_t data = file->data;
+  const char *server = file->device->net->server;
+  struct http_conn *conn = data->conn;
+  grub_off_t last = 0;
   grub_uint8_t *ptr;
-  int i;
   struct grub_net_buff *nb;
   grub_err_t err;
 
+  if (data->range_size)
+    {
+      last = offset + data->range_size - 1;
+      if (file->size != GRUB_FILE_SIZE_UNKNOWN && last >= file->size)
+	last = file->size - 1;
+    }
+
   nb = grub_netbuff_alloc (GRUB_NET_TCP_RESERVE_SIZE
 			   + sizeof ("GET ") - 1
 			   + grub_strlen (data->filename)
 			   + sizeof (" HTTP/1.1\r\nHost: ") - 1
-			   + grub_strlen (file->device->net->server)
+			   + grub_strlen (server)
 			   + sizeof ("\r\nUser-Agent: " PACKAGE_STRING
 				     "\r\n") - 1
 			   + sizeof ("Range: bytes=XXXXXXXXXXXXXXXXXXXX"
-				     "-\r\n\r\n"));
+				     "-XXXXXXXXXXXXXXXXXXXX\r\n\r\n"));
   if (!nb)
     return grub_errno;
 
@@ -356,14 +635,13 @@ http_establish (struct grub_file *file, grub_off_t offset, int initial)
 	       sizeof (" HTTP/1.1\r\nHost: ") - 1);
 
   ptr = nb->tail;
-  err = grub_netbuff_put (nb, grub_strlen (file->device->net->server));
+  err = grub_netbuff_put (nb, grub_strlen (server));
   if (err)
     {
       grub_netbuff_free (nb);
       return err;
     }
-  grub_memcpy (ptr, file->device->net->server,
-	       grub_strlen (file->device->net->server));
+  grub_memcpy (ptr, server, grub_strlen (server));
 
   ptr = nb->tail;
   err = grub_netbuff_put (nb, 
@@ -376,49 +654,124 @@ http_establish (struct grub_file *file, grub_off_t offset, int initial)
     }
   grub_memcpy (ptr, "\r\nUser-Agent: " PACKAGE_STRING "\r\n",
 	       sizeof ("\r\nUser-Agent: " PACKAGE_STRING "\r\n") - 1);
-  if (!initial)
+  if (offset || data->range_size)
     {
       ptr = nb->tail;
-      grub_snprintf ((char *) ptr,
-		     sizeof ("Range: bytes=XXXXXXXXXXXXXXXXXXXX-"
-			     "\r\n"
-			     "\r\n"),
-		     "Range: bytes=%" PRIuGRUB_UINT64_T "-\r\n\r\n",
-		     offset);
+      if (data->range_size)
+	grub_snprintf ((char *) ptr,
+		       sizeof ("Range: bytes=XXXXXXXXXXXXXXXXXXXX"
+			       "-XXXXXXXXXXXXXXXXXXXX\r\n"),
+		       "Range: bytes=%" PRIuGRUB_UINT64_T "-%"
+		       PRIuGRUB_UINT64_T "\r\n",
+		       (grub_uint64_t) offset, (grub_uint64_t) last);
+      else
+	grub_snprintf ((char *) ptr,
+		       sizeof ("Range: bytes=XXXXXXXXXXXXXXXXXXXX-\r\n"),
+		       "Range: bytes=%" PRIuGRUB_UINT64_T "-\r\n",
+		       (grub_uint64_t) offset);
       grub_netbuff_put (nb, grub_strlen ((char *) ptr));
     }
   ptr = nb->tail;
   grub_netbuff_put (nb, 2);
   grub_memcpy (ptr, "\r\n", 2);
 
-  data->sock = grub_net_tcp_open (file->device->net->server,
-				  HTTP_PORT, http_receive,
-				  http_err, http_err,
-				  file);
-  if (!data->sock)
+  if (reused)
+    *reused = !!conn;
+  if (!conn)
     {
-      grub_netbuff_free (nb);
-      return grub_errno;
+      FOR_LIST_ELEMENTS (conn, http_idle_conns)
+	if (grub_strcmp (conn->server, server) == 0)
+	  break;
+      if (conn)
+	{
+	  grub_list_remove (GRUB_AS_LIST (conn));
+	  if (reused)
+	    *reused = 1;
+	}
+      else
+	{
+	  conn = grub_zalloc (sizeof (*conn));
+	  if (!conn)
+	    {
+	      grub_netbuff_free (nb);
+	      return grub_errno;
+	    }
+	  conn->server = grub_strdup (server);
+	  if (!conn->server)
+	    {
+	      grub_free (conn);
+	      grub_netbuff_free (nb);
+	      return grub_errno;
+	    }
+	  conn->sock = grub_net_tcp_open (conn->server,
+					  HTTP_PORT, http_receive,
+					  http_err, http_err,
+					  conn);
+	  if (!conn->sock)
+	    {
+	      grub_free (conn->server);
+	      grub_free (conn);
+	      grub_netbuff_free (nb);
+	      return grub_errno;
+	    }
+	}
+      conn->file = file;
+      data->conn = conn;
+      data->keep_alive = 1;
     }
 
-  //  grub_net_poll_cards (5000);
-
-  err = grub_net_send_tcp_packet (data->sock, nb, 1);
+  err = grub_net_send_tcp_packet (conn->sock, nb, 1);
   if (err)
-    {
-      grub_net_tcp_close (data->sock, GRUB_NET_TCP_ABORT);
-      return err;
-    }
+    return err;
+  data->in_flight++;
+  if (data->range_size)
+    data->next_offset = last + 1;
+  return GRUB_ERR_NONE;
+}
 
-  for (i = 0; !data->headers_recv && i < 100; i++)
+static grub_err_t
+http_establish (struct grub_file *file, grub_off_t offset)
+{
+  http_data_t data = file->data;
+  grub_err_t err;
+  int i, try;
+
+  data->recv_offset = offset;
+  data->resume_offset = offset;
+  data->response_ready = 0;
+  for (try = 0; try < 2; try++)
     {
-      grub_net_tcp_retransmit ();
-      grub_net_poll_cards (300, &data->headers_recv);
+      int reused;
+
+      err = http_request (file, offset, &reused);
+      if (err)
+	{
+	  http_release (data);
+	  return err;
+	}
+
+      for (i = 0; !data->response_ready && data->conn && i < 100; i++)
+	{
+	  grub_net_tcp_retransmit ();
+	  grub_net_poll_cards (300, &data->response_ready);
+	}
+
+      /* A reused connection may have been closed by the server before
+	 our request reached it.  */
+      if (data->response_ready || data->conn || !reused
+	  || data->first_line_recv)
+	break;
+      http_reset_response (data);
+      data->in_flight = 0;
+      data->discard = 0;
+      data->resume = 0;
+      file->device->net->eof = 0;
+      file->device->net->stall = 0;
     }
 
-  if (!data->headers_recv)
+  if (!data->response_ready || data->err)
     {
-      grub_net_tcp_close (data->sock, GRUB_NET_TCP_ABORT);
+      http_release (data);
       if (data->err)
 	{
 	  char *str = data->errmsg;
@@ -435,13 +788,9 @@ http_establish (struct grub_file *file, grub_off_t offset, int initial)
 static grub_err_t
 http_seek (struct grub_file *file, grub_off_t off)
 {
-  struct http_data *old_data, *data;
+  http_data_t data = file->data;
+  grub_off_t left;
   grub_err_t err;
-  old_data = file->data;
-  /* FIXME: Reuse socket?  */
-  if (old_data->sock)
-    grub_net_tcp_close (old_data->sock, GRUB_NET_TCP_ABORT);
-  old_data->sock = 0;
 
   while (file->device->net->packs.first)
     {
@@ -450,26 +799,38 @@ http_seek (struct grub_file *file, grub_off_t off)
     }
 
   file->device->net->stall = 0;
+  file->device->net->eof = 0;
   file->device->net->offset = off;
 
-  data = grub_zalloc (sizeof (*data));
-  if (!data)
-    return grub_errno;
-
-  data->size_recv = 1;
-  data->filename = old_data->filename;
-  if (!data->filename)
+  /* Responses still in flight are read to the end and dropped if that is
+     cheap, so that the connection can carry the new request.  In readahead
+     mode they are bounded by the range size.  */
+  if (!data->in_flight)
+    left = 0;
+  else if (data->range_size)
+    left = data->in_flight * data->range_size;
+  else if (data->headers_recv && data->have_length && !data->chunked)
+    left = data->body_rem;
+  else
+    left = HTTP_DRAIN_LIMIT + 1;
+
+  if (data->conn && data->keep_alive
+      && (data->range_size || left <= HTTP_DRAIN_LIMIT))
+    data->discard = data->in_flight;
+  else
     {
-      grub_free (data);
-      file->data = 0;
-      return grub_errno;
+      http_release (data);
+      data->in_flight = 0;
+      data->discard = 0;
+      http_reset_response (data);
     }
-  grub_free (old_data);
 
-  file->data = data;
-  err = http_establish (file, off, 0);
+  data->size_recv = 1;
+  data->resume = 0;
+  err = http_establish (file, off);
   if (err)
     {
+      http_release (data);
       grub_free (data->filename);
       grub_free (data);
       file->data = 0;
@@ -483,6 +844,7 @@ http_open (struct grub_file *file, const char *filename)
 {
   grub_err_t err;
   struct http_data *data;
+  const char *range;
 
   data = grub_zalloc (sizeof (*data));
   if (!data)
@@ -496,12 +858,23 @@ http_open (struct grub_file *file, const char *filename)
       return grub_errno;
     }
 
+  range = grub_env_get ("net_http_range_size");
+  if (range)
+    {
+      data->range_size = grub_strtoull (range, 0, 0);
+      grub_errno = GRUB_ERR_NONE;
+      if (data->range_size && data->range_size < HTTP_MIN_RANGE_SIZE)
+	data->range_size = HTTP_MIN_RANGE_SIZE;
+    }
+
   file->not_easily_seekable = 0;
   file->data = data;
 
-  err = http_establish (file, 0, 1);
+  err = http_establish (file, 0);
   if (err)
     {
+      http_release (data);
+      grub_free (data->current_line);
       grub_free (data->filename);
       grub_free (data);
       return err;
@@ -518,8 +891,7 @@ http_close (struct grub_file *file)
   if (!data)
     return GRUB_ERR_NONE;
 
-  if (data->sock)
-    grub_net_tcp_close (data->sock, GRUB_NET_TCP_ABORT);
+  http_release (data);
   if (data->current_line)
     grub_free (data->current_line);
   grub_free (data->filename);
@@ -535,10 +907,23 @@ http_packets_pulled (struct grub_file *file)
   if (file->device->net->packs.count >= 20)
     return 0;
 
+  if (data && data->resume)
+    {
+      data->resume = 0;
+      data->resume_offset = data->recv_offset;
+      if (http_request (file, data->recv_offset, 0))
+	{
+	  grub_errno = GRUB_ERR_NONE;
+	  file->device->net->eof = 1;
+	  file->device->net->stall = 1;
+	  return 0;
+	}
+    }
+
   if (!file->device->net->eof)
     file->device->net->stall = 0;
-  if (data && data->sock)
-    grub_net_tcp_unstall (data->sock);
+  if (data && data->conn)
+    grub_net_tcp_unstall (data->conn->sock);
   return 0;
 }
 
@@ -558,5 +943,12 @@ GRUB_MOD_INIT (http)
 
 GRUB_MOD_FINI (http)
 {
+  struct http_conn *conn, *next;
+
+  FOR_LIST_ELEMENTS_SAFE (conn, next, http_idle_conns)
+    {
+      grub_list_remove (GRUB_AS_LIST (conn));
+      http_conn_drop (conn);
+    }
   grub_net_app_level_unregister (&grub_http_protocol);
 }
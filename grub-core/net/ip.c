@@ -90,7 +90,24 @@ struct reassemble
   grub_uint8_t ttl;
 };
 
-static struct reassemble *reassembles;
+/* Datagrams being reassembled, hashed by their addresses and ID.  */
+#define REASSEMBLE_HASH_BITS 4
+#define REASSEMBLE_HASH_SIZE (1 << REASSEMBLE_HASH_BITS)
+
+/* Fragments older than this are dropped.  */
+#define REASSEMBLE_TIMEOUT 90000
+
+static struct reassemble *reassembles[REASSEMBLE_HASH_SIZE];
+static grub_uint64_t last_fragment_sweep;
+
+static inline struct reassemble **
+reassemble_bucket (grub_uint32_t source, grub_uint32_t dest,
+		   grub_uint16_t id, grub_uint8_t proto)
+{
+  return &reassembles[grub_net_hash_bits (source ^ dest
+					  ^ ((grub_uint32_t) id << 8) ^ proto,
+					  REASSEMBLE_HASH_BITS)];
+}
 
 grub_uint16_t
 grub_net_ip_chksum (void *ipv, grub_size_t len)
@@ -360,18 +377,29 @@ static void
 free_old_fragments (void)
 {
   struct reassemble *rsm, **prev;
-  grub_uint64_t limit_time = grub_get_time_ms () - 90000;
-
-  for (prev = &reassembles, rsm = *prev; rsm; rsm = *prev)
-    if (rsm->last_time < limit_time)
-      {
-	*prev = rsm->next;
-	free_rsm (rsm);
-      }
-    else
-      {
-	prev = &rsm->next;
-      }
+  grub_uint64_t ctime = grub_get_time_ms ();
+  grub_uint64_t limit_time;
+  unsigned i;
+
+  /* The timeout is coarse, so don't walk every bucket for each fragment.  */
+  if (ctime >= last_fragment_sweep && ctime < last_fragment_sweep + 1000)
+    return;
+  last_fragment_sweep = ctime;
+  if (ctime < REASSEMBLE_TIMEOUT)
+    return;
+  limit_time = ctime - REASSEMBLE_TIMEOUT;
+
+  for (i = 0; i < REASSEMBLE_HASH_SIZE; i++)
+    for (prev = &reassembles[i], rsm = *prev; rsm; rsm = *prev)
+      if (rsm->last_time < limit_time)
+	{
+	  *prev = rsm->next;
+	  free_rsm (rsm);
+	}
+      else
+	{
+	  prev = &rsm->next;
+	}
 }
 
 static grub_err_t
@@ -382,7 +410,7 @@ grub_net_recv_ip4_packets (struct grub_net_buff *nb,
 {
   struct iphdr *iph = (struct iphdr *) nb->data;
   grub_err_t err;
-  struct reassemble *rsm, **prev;
+  struct reassemble *rsm, **prev, **bucket;
 
   if ((iph->verhdrlen >> 4) != 4)
     {
@@ -456,7 +484,11 @@ grub_net_recv_ip4_packets (struct grub_net_buff *nb,
 			   &source, &dest, iph->ttl);
     }
 
-  for (prev = &reassembles, rsm = *prev; rsm; prev = &rsm->next, rsm = *prev)
+  /* Expire old datagrams first: it may unlink entries PREV points into.  */
+  free_old_fragments ();
+
+  bucket = reassemble_bucket (iph->src, iph->dest, iph->ident, iph->protocol);
+  for (prev = bucket, rsm = *prev; rsm; prev = &rsm->next, rsm = *prev)
     if (rsm->source == iph->src && rsm->dest == iph->dest
 	&& rsm->id == iph->ident && rsm->proto == iph->protocol)
       break;
@@ -469,15 +501,15 @@ grub_net_recv_ip4_packets (struct grub_net_buff *nb,
       rsm->dest = iph->dest;
       rsm->id = iph->ident;
       rsm->proto = iph->protocol;
-      rsm->next = reassembles;
-      reassembles = rsm;
-      prev = &reassembles;
       rsm->pq = grub_priority_queue_new (sizeof (struct grub_net_buff **), cmp);
       if (!rsm->pq)
 	{
 	  grub_free (rsm);
 	  return grub_errno;
 	}
+      rsm->next = *bucket;
+      *bucket = rsm;
+      prev = bucket;
       rsm->asm_netbuff = 0;
       rsm->total_len = 0;
       rsm->cur_ptr = 0;
@@ -486,7 +518,6 @@ grub_net_recv_ip4_packets (struct grub_net_buff *nb,
   if (rsm->ttl > iph->ttl)
     rsm->ttl = iph->ttl;
   rsm->last_time = grub_get_time_ms ();
-  free_old_fragments ();
 
   err = grub_priority_queue_push (rsm->pq, &nb);
   if (err)
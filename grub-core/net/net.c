@@ -207,6 +207,8 @@ grub_net_card_unregister (struct grub_net_card *card)
 	card->driver->close (card);
       card->opened = 0;
     }
+  grub_netbuff_pool_destroy (card->rx_pool);
+  card->rx_pool = NULL;
   grub_list_remove (GRUB_AS_LIST (card));
 }
 
@@ -781,6 +783,22 @@ grub_net_addr_cmp (const grub_net_network_level_address_t *a,
   return 1;
 }
 
+grub_uint32_t
+grub_net_addr_hash (const grub_net_network_level_address_t *a)
+{
+  switch (a->type)
+    {
+    case GRUB_NET_NETWORK_LEVEL_PROTOCOL_IPV4:
+      return a->ipv4;
+    case GRUB_NET_NETWORK_LEVEL_PROTOCOL_IPV6:
+      return (a->ipv6[0] ^ (a->ipv6[0] >> 32)
+	      ^ a->ipv6[1] ^ (a->ipv6[1] >> 32));
+    case GRUB_NET_NETWORK_LEVEL_PROTOCOL_DHCP_RECV:
+      return 0;
+    }
+  return 0;
+}
+
 /* FIXME: implement this. */
 static char *
 hwaddr_set_env (struct grub_env_var *var __attribute__ ((unused)),
@@ -1427,10 +1445,14 @@ receive_packets (struct grub_net_card *card, int *stop_condition)
 	}
       card->opened = 1;
     }
+  /* Drivers receive into buffers from this pool, which the stack returns
+     to it when done instead of going through the heap for every frame.
+     Without a pool they fall back to plain allocations.  */
+  if (!card->rx_pool)
+    card->rx_pool = grub_netbuff_pool_new ((card->mtu ? card->mtu : 1500)
+					   + 64 + 2, GRUB_NET_RX_POOL_SIZE);
   while (1)
     {
-      /* Maybe should be better have a fixed number of packets for each card
-	 and just mark them as used and not used.  */ 
       struct grub_net_buff *nb;
 
       if (received > 10 && stop_condition && *stop_condition)
@@ -1462,8 +1484,13 @@ grub_net_poll_cards (unsigned time, int *stop_condition)
   start_time = grub_get_time_ms ();
   while ((grub_get_time_ms () - start_time) < time
 	 && (!stop_condition || !*stop_condition))
-    FOR_NET_CARDS (card)
-      receive_packets (card, stop_condition);
+    {
+      FOR_NET_CARDS (card)
+	receive_packets (card, stop_condition);
+      /* Also sends delayed TCP ACKs, which must not wait for the whole
+	 polling interval.  */
+      grub_net_tcp_retransmit ();
+    }
   grub_net_tcp_retransmit ();
 }
 
@@ -1620,12 +1647,16 @@ grub_net_fini_hw (int noreturn __attribute__ ((unused)))
 {
   struct grub_net_card *card;
   FOR_NET_CARDS (card) 
-    if (card->opened)
-      {
-	if (card->driver->close)
-	  card->driver->close (card);
-	card->opened = 0;
-      }
+    {
+      if (card->opened)
+	{
+	  if (card->driver->close)
+	    card->driver->close (card);
+	  card->opened = 0;
+	}
+      grub_netbuff_pool_destroy (card->rx_pool);
+      card->rx_pool = NULL;
+    }
   return GRUB_ERR_NONE;
 }
 
@@ -71,18 +71,26 @@ grub_netbuff_reserve (struct grub_net_buff *nb, grub_size_t len)
   return GRUB_ERR_NONE;
 }
 
-struct grub_net_buff *
-grub_netbuff_alloc (grub_size_t len)
+/* A fixed set of equally sized buffers.  Buffers freed with
+   grub_netbuff_free go back to the free list instead of the heap.  */
+struct grub_net_buff_pool
+{
+  struct grub_net_buff *free;
+  /* Usable length of each buffer.  */
+  grub_size_t len;
+  /* Buffers belonging to the pool, free or not.  */
+  unsigned count;
+  /* Set once the owner is gone; buffers still in use are then released to
+     the heap and the pool itself with the last of them.  */
+  int dead;
+};
+
+static struct grub_net_buff *
+netbuff_alloc_aligned (grub_size_t len)
 {
   struct grub_net_buff *nb;
   void *data;
 
-  COMPILE_TIME_ASSERT (NETBUFF_ALIGN % sizeof (grub_properly_aligned_t) == 0);
-
-  if (len < NETBUFFMINLEN)
-    len = NETBUFFMINLEN;
-
-  len = ALIGN_UP (len, NETBUFF_ALIGN);
   data = grub_memalign (NETBUFF_ALIGN, len + sizeof (*nb));
   if (!data)
     return NULL;
@@ -90,15 +98,108 @@ grub_netbuff_alloc (grub_size_t len)
 				 + len / sizeof (grub_properly_aligned_t));
   nb->head = nb->data = nb->tail = data;
   nb->end = (grub_uint8_t *) nb;
+  nb->pool = NULL;
+  nb->next_free = NULL;
   return nb;
 }
 
+struct grub_net_buff *
+grub_netbuff_alloc (grub_size_t len)
+{
+  COMPILE_TIME_ASSERT (NETBUFF_ALIGN % sizeof (grub_properly_aligned_t) == 0);
+
+  if (len < NETBUFFMINLEN)
+    len = NETBUFFMINLEN;
+
+  return netbuff_alloc_aligned (ALIGN_UP (len, NETBUFF_ALIGN));
+}
+
 void
 grub_netbuff_free (struct grub_net_buff *nb)
 {
+  struct grub_net_buff_pool *pool;
+
   if (!nb)
     return;
+  pool = nb->pool;
+  if (!pool)
+    {
+      grub_free (nb->head);
+      return;
+    }
+  if (!pool->dead)
+    {
+      nb->next_free = pool->free;
+      pool->free = nb;
+      return;
+    }
   grub_free (nb->head);
+  if (--pool->count == 0)
+    grub_free (pool);
+}
+
+struct grub_net_buff_pool *
+grub_netbuff_pool_new (grub_size_t len, unsigned count)
+{
+  struct grub_net_buff_pool *pool;
+
+  pool = grub_zalloc (sizeof (*pool));
+  if (!pool)
+    return NULL;
+  if (len < NETBUFFMINLEN)
+    len = NETBUFFMINLEN;
+  pool->len = ALIGN_UP (len, NETBUFF_ALIGN);
+
+  for (; count; count--)
+    {
+      struct grub_net_buff *nb;
+
+      nb = netbuff_alloc_aligned (pool->len);
+      if (!nb)
+	break;
+      nb->pool = pool;
+      nb->next_free = pool->free;
+      pool->free = nb;
+      pool->count++;
+    }
+  grub_errno = GRUB_ERR_NONE;
+  return pool;
+}
+
+/* Take a buffer of at least LEN bytes from POOL.  Oversized requests and
+   an exhausted or missing pool fall back to grub_netbuff_alloc.  */
+struct grub_net_buff *
+grub_netbuff_pool_alloc (struct grub_net_buff_pool *pool, grub_size_t len)
+{
+  struct grub_net_buff *nb;
+
+  if (!pool || !pool->free || len > pool->len)
+    return grub_netbuff_alloc (len);
+
+  nb = pool->free;
+  pool->free = nb->next_free;
+  nb->next_free = NULL;
+  nb->data = nb->tail = nb->head;
+  return nb;
+}
+
+void
+grub_netbuff_pool_destroy (struct grub_net_buff_pool *pool)
+{
+  struct grub_net_buff *nb, *next;
+
+  if (!pool)
+    return;
+  pool->dead = 1;
+  for (nb = pool->free; nb; nb = next)
+    {
+      next = nb->next_free;
+      grub_free (nb->head);
+      pool->count--;
+    }
+  pool->free = NULL;
+  if (pool->count == 0)
+    grub_free (pool);
 }
 
 grub_err_t
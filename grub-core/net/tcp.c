@@ -22,12 +22,39 @@
 #include <grub/net/netbuff.h>
 #include <grub/time.h>
 #include <grub/priority_queue.h>
+#include <grub/env.h>
+#include <grub/misc.h>
+#if !defined (GRUB_MACHINE_EMU) && !defined (GRUB_UTIL)
+#include <grub/mm_private.h>
+#endif
 
 #define TCP_SYN_RETRANSMISSION_TIMEOUT GRUB_NET_INTERVAL
 #define TCP_SYN_RETRANSMISSION_COUNT GRUB_NET_TRIES
 #define TCP_RETRANSMISSION_TIMEOUT GRUB_NET_INTERVAL
 #define TCP_RETRANSMISSION_COUNT GRUB_NET_TRIES
 
+/* Data is acknowledged after every TCP_DELAYED_ACK_SEGMENTS segments
+   or TCP_DELAYED_ACK_TIMEOUT ms, whichever comes first.  */
+#define TCP_DELAYED_ACK_SEGMENTS 2
+#define TCP_DELAYED_ACK_TIMEOUT 40
+
+/* Receive window bounds.  Unless overridden by $net_tcp_window, the window
+   is 1/TCP_WINDOW_HEAP_FRACTION of the free heap.  */
+#define TCP_MIN_WINDOW 8192
+#define TCP_MAX_WINDOW (4 << 20)
+#define TCP_WINDOW_HEAP_FRACTION 16
+#define TCP_MAX_WINDOW_SHIFT 14
+
+#define TCP_MAX_SACK_BLOCKS 4
+#define TCP_MAX_OPTIONS_SIZE 40
+/* MSS, NOP + window scale, 2 x NOP + SACK permitted.  */
+#define TCP_SYN_OPTIONS_SIZE 12
+
+/* Sockets are also hashed by their address and ports so that incoming
+   segments find theirs without walking every socket.  */
+#define TCP_HASH_BITS 6
+#define TCP_HASH_SIZE (1 << TCP_HASH_BITS)
+
 struct unacked
 {
   struct unacked *next;
@@ -47,10 +74,28 @@ enum
     TCP_URG = 0x20,
   };
 
+enum
+  {
+    TCP_OPT_END = 0,
+    TCP_OPT_NOP = 1,
+    TCP_OPT_MSS = 2,
+    TCP_OPT_WINDOW_SCALE = 3,
+    TCP_OPT_SACK_PERMITTED = 4,
+    TCP_OPT_SACK = 5
+  };
+
+struct tcp_sack_block
+{
+  grub_uint32_t start;
+  grub_uint32_t end;
+};
+
 struct grub_net_tcp_socket
 {
   struct grub_net_tcp_socket *next;
   struct grub_net_tcp_socket **prev;
+  struct grub_net_tcp_socket *hash_next;
+  struct grub_net_tcp_socket **hash_prev;
 
   int established;
   int i_closed;
@@ -65,7 +110,14 @@ struct grub_net_tcp_socket
   grub_uint32_t my_cur_seq;
   grub_uint32_t their_start_seq;
   grub_uint32_t their_cur_seq;
-  grub_uint16_t my_window;
+  grub_uint32_t my_window;
+  int my_window_shift;
+  int window_scaling;
+  int sack_permitted;
+  int ack_pending;
+  grub_uint64_t ack_deadline;
+  int num_sack;
+  struct tcp_sack_block sack[TCP_MAX_SACK_BLOCKS];
   struct unacked *unack_first;
   struct unacked *unack_last;
   grub_err_t (*recv_hook) (grub_net_tcp_socket_t sock, struct grub_net_buff *nb,
@@ -125,6 +177,7 @@ struct tcp6_pseudohdr
 } __attribute__ ((packed));
 
 static struct grub_net_tcp_socket *tcp_sockets;
+static struct grub_net_tcp_socket *tcp_hash[TCP_HASH_SIZE];
 static struct grub_net_tcp_listen *tcp_listens;
 
 #define FOR_TCP_SOCKETS(var) FOR_LIST_ELEMENTS (var, tcp_sockets)
@@ -156,11 +209,235 @@ grub_net_tcp_stop_listen (grub_net_tcp_listen_t listen)
   grub_list_remove (GRUB_AS_LIST (listen));
 }
 
+static inline struct grub_net_tcp_socket **
+tcp_hash_bucket (int in_port, int out_port,
+		 const grub_net_network_level_address_t *addr)
+{
+  return &tcp_hash[grub_net_hash_bits (grub_net_addr_hash (addr)
+				       ^ (in_port << 16) ^ out_port,
+				       TCP_HASH_BITS)];
+}
+
 static inline void
 tcp_socket_register (grub_net_tcp_socket_t sock)
 {
+  struct grub_net_tcp_socket **bucket;
+
   grub_list_push (GRUB_AS_LIST_P (&tcp_sockets),
 		  GRUB_AS_LIST (sock));
+
+  bucket = tcp_hash_bucket (sock->in_port, sock->out_port, &sock->out_nla);
+  sock->hash_next = *bucket;
+  sock->hash_prev = bucket;
+  if (*bucket)
+    (*bucket)->hash_prev = &sock->hash_next;
+  *bucket = sock;
+}
+
+static inline void
+tcp_socket_unregister (grub_net_tcp_socket_t sock)
+{
+  grub_list_remove (GRUB_AS_LIST (sock));
+
+  if (sock->hash_prev)
+    *sock->hash_prev = sock->hash_next;
+  if (sock->hash_next)
+    sock->hash_next->hash_prev = sock->hash_prev;
+  sock->hash_next = NULL;
+  sock->hash_prev = NULL;
+}
+
+/* Size of the receive window offered to new connections.  */
+static grub_uint32_t
+tcp_receive_window (void)
+{
+  grub_uint64_t window = TCP_MAX_WINDOW;
+  const char *val;
+
+  val = grub_env_get ("net_tcp_window");
+  if (val)
+    {
+      window = grub_strtoull (val, 0, 0);
+      if (grub_errno)
+	{
+	  grub_errno = GRUB_ERR_NONE;
+	  window = TCP_MAX_WINDOW;
+	}
+    }
+#if !defined (GRUB_MACHINE_EMU) && !defined (GRUB_UTIL)
+  else
+    {
+      grub_mm_region_t r;
+      grub_uint64_t heap_free = 0;
+
+      for (r = grub_mm_base; r; r = r->next)
+	{
+	  grub_mm_header_t p;
+
+	  /* A region whose first block is allocated has no free blocks.  */
+	  if (r->first->magic != GRUB_MM_FREE_MAGIC)
+	    continue;
+	  p = r->first;
+	  do
+	    {
+	      heap_free += (grub_uint64_t) p->size << GRUB_MM_ALIGN_LOG2;
+	      p = p->next;
+	    }
+	  while (p != r->first);
+	}
+      window = heap_free / TCP_WINDOW_HEAP_FRACTION;
+    }
+#endif
+
+  if (window < TCP_MIN_WINDOW)
+    window = TCP_MIN_WINDOW;
+  if (window > TCP_MAX_WINDOW)
+    window = TCP_MAX_WINDOW;
+  return window;
+}
+
+static int
+tcp_window_shift (grub_uint32_t window)
+{
+  int shift = 0;
+  while ((window >> shift) > 0xffff && shift < TCP_MAX_WINDOW_SHIFT)
+    shift++;
+  return shift;
+}
+
+/* Window field for outgoing segments, in network byte order.  */
+static grub_uint16_t
+tcp_window (grub_net_tcp_socket_t sock)
+{
+  grub_uint32_t window;
+
+  if (sock->i_stall)
+    return 0;
+  window = sock->my_window >> sock->my_window_shift;
+  if (window > 0xffff)
+    window = 0xffff;
+  return grub_cpu_to_be16 (window);
+}
+
+/* Append MSS, window scale and SACK permitted options to the SYN header
+   in NB and set its data offset.  A SYN+ACK (REPLY) carries window scale
+   and SACK permitted only if the peer offered them.  */
+static grub_err_t
+tcp_put_syn_options (grub_net_tcp_socket_t sock, struct grub_net_buff *nb,
+		     int reply)
+{
+  struct tcphdr *tcph = (struct tcphdr *) nb->data;
+  grub_uint8_t *opt;
+  grub_uint16_t mss;
+  grub_err_t err;
+
+  err = grub_netbuff_put (nb, TCP_SYN_OPTIONS_SIZE);
+  if (err)
+    return err;
+
+  if (sock->out_nla.type == GRUB_NET_NETWORK_LEVEL_PROTOCOL_IPV4)
+    mss = (sock->inf->card->mtu - GRUB_NET_OUR_IPV4_HEADER_SIZE
+	   - sizeof (*tcph));
+  else
+    mss = 1280 - GRUB_NET_OUR_IPV6_HEADER_SIZE - sizeof (*tcph);
+
+  opt = (grub_uint8_t *) (tcph + 1);
+  opt[0] = TCP_OPT_MSS;
+  opt[1] = 4;
+  opt[2] = mss >> 8;
+  opt[3] = mss & 0xff;
+  grub_memset (opt + 4, TCP_OPT_NOP, TCP_SYN_OPTIONS_SIZE - 4);
+  if (!reply || sock->window_scaling)
+    {
+      opt[5] = TCP_OPT_WINDOW_SCALE;
+      opt[6] = 3;
+      opt[7] = sock->my_window_shift;
+    }
+  if (!reply || sock->sack_permitted)
+    {
+      opt[10] = TCP_OPT_SACK_PERMITTED;
+      opt[11] = 2;
+    }
+  tcph->flags = grub_cpu_to_be16 (((5 + TCP_SYN_OPTIONS_SIZE / 4) << 12)
+				  | (grub_be_to_cpu16 (tcph->flags) & 0x3f));
+  return GRUB_ERR_NONE;
+}
+
+/* Record which of our offers the peer accepted in its SYN.  Without
+   window scaling the window is limited to what fits in 16 bits.  */
+static void
+tcp_parse_syn_options (grub_net_tcp_socket_t sock, struct tcphdr *tcph)
+{
+  grub_uint8_t *opt = (grub_uint8_t *) (tcph + 1);
+  grub_uint8_t *end = ((grub_uint8_t *) tcph
+		       + (grub_be_to_cpu16 (tcph->flags) >> 12) * 4);
+
+  sock->window_scaling = 0;
+  sock->sack_permitted = 0;
+  while (opt < end && *opt != TCP_OPT_END)
+    {
+      if (*opt == TCP_OPT_NOP)
+	{
+	  opt++;
+	  continue;
+	}
+      if (opt + 1 >= end || opt[1] < 2 || opt + opt[1] > end)
+	break;
+      if (opt[0] == TCP_OPT_WINDOW_SCALE && opt[1] == 3)
+	sock->window_scaling = 1;
+      if (opt[0] == TCP_OPT_SACK_PERMITTED && opt[1] == 2)
+	sock->sack_permitted = 1;
+      opt += opt[1];
+    }
+
+  if (!sock->window_scaling)
+    {
+      sock->my_window_shift = 0;
+      if (sock->my_window > 0xffff)
+	sock->my_window = 0xffff;
+    }
+}
+
+/* Remember that [START, END) arrived out of order.  Overlapping or adjacent
+   blocks are merged and the most recent block goes first, as RFC 2018
+   requires.  */
+static void
+tcp_sack_add (grub_net_tcp_socket_t sock, grub_uint32_t start,
+	      grub_uint32_t end)
+{
+  struct tcp_sack_block kept[TCP_MAX_SACK_BLOCKS];
+  int i, n = 0;
+
+  for (i = 0; i < sock->num_sack; i++)
+    {
+      if (sock->sack[i].end < start || sock->sack[i].start > end)
+	{
+	  kept[n++] = sock->sack[i];
+	  continue;
+	}
+      if (sock->sack[i].start < start)
+	start = sock->sack[i].start;
+      if (sock->sack[i].end > end)
+	end = sock->sack[i].end;
+    }
+  if (n > TCP_MAX_SACK_BLOCKS - 1)
+    n = TCP_MAX_SACK_BLOCKS - 1;
+  sock->sack[0].start = start;
+  sock->sack[0].end = end;
+  grub_memcpy (sock->sack + 1, kept, n * sizeof (kept[0]));
+  sock->num_sack = n + 1;
+}
+
+/* Drop the blocks made obsolete by the cumulative acknowledgement.  */
+static void
+tcp_sack_trim (grub_net_tcp_socket_t sock)
+{
+  int i, n = 0;
+
+  for (i = 0; i < sock->num_sack; i++)
+    if (sock->sack[i].end > sock->their_cur_seq)
+      sock->sack[n++] = sock->sack[i];
+  sock->num_sack = n;
 }
 
 static void
@@ -198,6 +475,9 @@ tcp_send (struct grub_net_buff *nb, grub_net_tcp_socket_t socket)
   if (grub_be_to_cpu16 (tcph->flags) & TCP_FIN)
     size++;
   socket->my_cur_seq += size;
+  /* Every ACK carries their_cur_seq, so it covers any delayed one.  */
+  if (tcph->flags & grub_cpu_to_be16_compile_time (TCP_ACK))
+    socket->ack_pending = 0;
   tcph->src = grub_cpu_to_be16 (socket->in_port);
   tcph->dst = grub_cpu_to_be16 (socket->out_port);
   tcph->checksum = 0;
@@ -300,8 +580,13 @@ ack_real (grub_net_tcp_socket_t sock, int res)
   struct grub_net_buff *nb_ack;
   struct tcphdr *tcph_ack;
   grub_err_t err;
+  grub_size_t optlen = 0;
+
+  if (!res && sock->sack_permitted && sock->num_sack)
+    optlen = 4 + sock->num_sack * sizeof (sock->sack[0]);
 
-  nb_ack = grub_netbuff_alloc (sizeof (*tcph_ack) + 128);
+  nb_ack = grub_netbuff_alloc (sizeof (*tcph_ack) + TCP_MAX_OPTIONS_SIZE
+			       + 128);
   if (!nb_ack)
     return;
   err = grub_netbuff_reserve (nb_ack, 128);
@@ -313,7 +598,7 @@ ack_real (grub_net_tcp_socket_t sock, int res)
       return;
     }
 
-  err = grub_netbuff_put (nb_ack, sizeof (*tcph_ack));
+  err = grub_netbuff_put (nb_ack, sizeof (*tcph_ack) + optlen);
   if (err)
     {
       grub_netbuff_free (nb_ack);
@@ -331,9 +616,25 @@ ack_real (grub_net_tcp_socket_t sock, int res)
   else
     {
       tcph_ack->ack = grub_cpu_to_be32 (sock->their_cur_seq);
-      tcph_ack->flags = grub_cpu_to_be16_compile_time ((5 << 12) | TCP_ACK);
-      tcph_ack->window = !sock->i_stall ? grub_cpu_to_be16 (sock->my_window)
-	: 0;
+      tcph_ack->flags = grub_cpu_to_be16 (((5 + optlen / 4) << 12) | TCP_ACK);
+      tcph_ack->window = tcp_window (sock);
+      if (optlen)
+	{
+	  grub_uint8_t *opt = (grub_uint8_t *) (tcph_ack + 1);
+	  int i;
+
+	  opt[0] = TCP_OPT_NOP;
+	  opt[1] = TCP_OPT_NOP;
+	  opt[2] = TCP_OPT_SACK;
+	  opt[3] = optlen - 2;
+	  for (i = 0; i < sock->num_sack; i++)
+	    {
+	      grub_set_unaligned32 (opt + 4 + 8 * i,
+				    grub_cpu_to_be32 (sock->sack[i].start));
+	      grub_set_unaligned32 (opt + 8 + 8 * i,
+				    grub_cpu_to_be32 (sock->sack[i].end));
+	    }
+	}
     }
   tcph_ack->urgent = 0;
   tcph_ack->src = grub_cpu_to_be16 (sock->in_port);
@@ -368,6 +669,10 @@ grub_net_tcp_retransmit (void)
   FOR_TCP_SOCKETS (sock)
   {
     struct unacked *unack;
+
+    if (sock->ack_pending && ctime >= sock->ack_deadline)
+      ack (sock);
+
     for (unack = sock->unack_first; unack; unack = unack->next)
       {
 	struct tcphdr *tcph;
@@ -503,7 +808,7 @@ grub_net_tcp_accept (grub_net_tcp_socket_t sock,
   sock->error_hook = error_hook;
   sock->fin_hook = fin_hook;
   sock->hook_data = hook_data;
-  nb_ack = grub_netbuff_alloc (sizeof (*tcph)
+  nb_ack = grub_netbuff_alloc (sizeof (*tcph) + TCP_SYN_OPTIONS_SIZE
 			       + GRUB_NET_OUR_MAX_IP_HEADER_SIZE
 			       + GRUB_NET_MAX_LINK_HEADER_SIZE);
   if (!nb_ack)
@@ -525,8 +830,16 @@ grub_net_tcp_accept (grub_net_tcp_socket_t sock,
   tcph = (void *) nb_ack->data;
   tcph->ack = grub_cpu_to_be32 (sock->their_cur_seq);
   tcph->flags = grub_cpu_to_be16_compile_time ((5 << 12) | TCP_SYN | TCP_ACK);
-  tcph->window = grub_cpu_to_be16 (sock->my_window);
+  /* The window in a SYN is never scaled.  */
+  tcph->window = grub_cpu_to_be16 (sock->my_window > 0xffff ? 0xffff
+				   : sock->my_window);
   tcph->urgent = 0;
+  err = tcp_put_syn_options (sock, nb_ack, 1);
+  if (err)
+    {
+      grub_netbuff_free (nb_ack);
+      return err;
+    }
   sock->established = 1;
   tcp_socket_register (sock);
   err = tcp_send (nb_ack, sock);
@@ -593,7 +906,7 @@ grub_net_tcp_open (char *server,
   socket->fin_hook = fin_hook;
   socket->hook_data = hook_data;
 
-  nb = grub_netbuff_alloc (sizeof (*tcph) + 128);
+  nb = grub_netbuff_alloc (sizeof (*tcph) + TCP_SYN_OPTIONS_SIZE + 128);
   if (!nb)
     return NULL;
   err = grub_netbuff_reserve (nb, 128);
@@ -619,14 +932,25 @@ grub_net_tcp_open (char *server,
   tcph = (void *) nb->data;
   socket->my_start_seq = grub_get_time_ms ();
   socket->my_cur_seq = socket->my_start_seq + 1;
-  socket->my_window = 8192;
+  socket->my_window = tcp_receive_window ();
+  socket->my_window_shift = tcp_window_shift (socket->my_window);
   tcph->seqnr = grub_cpu_to_be32 (socket->my_start_seq);
   tcph->ack = grub_cpu_to_be32_compile_time (0);
   tcph->flags = grub_cpu_to_be16_compile_time ((5 << 12) | TCP_SYN);
-  tcph->window = grub_cpu_to_be16 (socket->my_window);
+  /* The window in a SYN is never scaled.  */
+  tcph->window = grub_cpu_to_be16 (socket->my_window > 0xffff ? 0xffff
+				   : socket->my_window);
   tcph->urgent = 0;
   tcph->src = grub_cpu_to_be16 (socket->in_port);
   tcph->dst = grub_cpu_to_be16 (socket->out_port);
+  err = tcp_put_syn_options (socket, nb, 0);
+  if (err)
+    {
+      grub_netbuff_free (nb);
+      destroy_pq (socket);
+      grub_free (socket);
+      return NULL;
+    }
   tcph->checksum = 0;
   tcph->checksum = grub_net_ip_transport_checksum (nb, GRUB_NET_IP_TCP,
 						   &socket->inf->address,
@@ -644,7 +968,7 @@ grub_net_tcp_open (char *server,
 				     GRUB_NET_IP_TCP);
       if (err)
 	{
-	  grub_list_remove (GRUB_AS_LIST (socket));
+	  tcp_socket_unregister (socket);
 	  grub_free (socket);
 	  grub_netbuff_free (nb);
 	  return NULL;
@@ -657,7 +981,7 @@ grub_net_tcp_open (char *server,
     }
   if (!socket->established)
     {
-      grub_list_remove (GRUB_AS_LIST (socket));
+      tcp_socket_unregister (socket);
       if (socket->they_reseted)
 	grub_error (GRUB_ERR_NET_PORT_CLOSED,
 		    N_("connection refused"));
@@ -709,8 +1033,7 @@ grub_net_send_tcp_packet (const grub_net_tcp_socket_t socket,
       tcph = (struct tcphdr *) nb2->data;
       tcph->ack = grub_cpu_to_be32 (socket->their_cur_seq);
       tcph->flags = grub_cpu_to_be16_compile_time ((5 << 12) | TCP_ACK);
-      tcph->window = !socket->i_stall ? grub_cpu_to_be16 (socket->my_window)
-	: 0;
+      tcph->window = tcp_window (socket);
       tcph->urgent = 0;
       err = grub_netbuff_put (nb2, fraglen);
       if (err)
@@ -733,7 +1056,7 @@ grub_net_send_tcp_packet (const grub_net_tcp_socket_t socket,
   tcph->ack = grub_cpu_to_be32 (socket->their_cur_seq);
   tcph->flags = (grub_cpu_to_be16_compile_time ((5 << 12) | TCP_ACK)
 		 | (push ? grub_cpu_to_be16_compile_time (TCP_PUSH) : 0));
-  tcph->window = !socket->i_stall ? grub_cpu_to_be16 (socket->my_window) : 0;
+  tcph->window = tcp_window (socket);
   tcph->urgent = 0;
   return tcp_send (nb, socket);
 }
@@ -746,6 +1069,8 @@ grub_net_recv_tcp_packet (struct grub_net_buff *nb,
   struct tcphdr *tcph;
   grub_net_tcp_socket_t sock;
   grub_err_t err;
+  grub_uint32_t seg_seq;
+  grub_ssize_t seg_len;
 
   /* Ignore broadcast.  */
   if (!inf)
@@ -771,7 +1096,9 @@ grub_net_recv_tcp_packet (struct grub_net_buff *nb,
       return GRUB_ERR_NONE;
     }
 
-  FOR_TCP_SOCKETS (sock)
+  for (sock = *tcp_hash_bucket (grub_be_to_cpu16 (tcph->dst),
+			       grub_be_to_cpu16 (tcph->src), source);
+       sock; sock = sock->hash_next)
   {
     if (!(grub_be_to_cpu16 (tcph->dst) == sock->in_port
 	  && grub_be_to_cpu16 (tcph->src) == sock->out_port
@@ -804,6 +1131,7 @@ grub_net_recv_tcp_packet (struct grub_net_buff *nb,
       {
 	sock->their_start_seq = grub_be_to_cpu32 (tcph->seqnr);
 	sock->their_cur_seq = sock->their_start_seq + 1;
+	tcp_parse_syn_options (sock, tcph);
 	sock->established = 1;
       }
 
@@ -858,6 +1186,10 @@ grub_net_recv_tcp_packet (struct grub_net_buff *nb,
 	reset (sock);
       }
 
+    seg_seq = grub_be_to_cpu32 (tcph->seqnr);
+    seg_len = (nb->tail - nb->data
+	       - (grub_be_to_cpu16 (tcph->flags) >> 12) * sizeof (grub_uint32_t));
+
     err = grub_priority_queue_push (sock->pq, &nb);
     if (err)
       {
@@ -869,6 +1201,7 @@ grub_net_recv_tcp_packet (struct grub_net_buff *nb,
       struct grub_net_buff **nb_top_p, *nb_top;
       int do_ack = 0;
       int just_closed = 0;
+      int had_sack = sock->num_sack;
       while (1)
 	{
 	  nb_top_p = grub_priority_queue_top (sock->pq);
@@ -882,7 +1215,14 @@ grub_net_recv_tcp_packet (struct grub_net_buff *nb,
 	  grub_priority_queue_pop (sock->pq);
 	}
       if (grub_be_to_cpu32 (tcph->seqnr) != sock->their_cur_seq)
-	return GRUB_ERR_NONE;
+	{
+	  /* Out of order: a duplicate ACK right away lets the sender
+	     retransmit the hole without waiting for its timer.  */
+	  if (seg_len > 0)
+	    tcp_sack_add (sock, seg_seq, seg_seq + seg_len);
+	  ack (sock);
+	  return GRUB_ERR_NONE;
+	}
       while (1)
 	{
 	  nb_top_p = grub_priority_queue_top (sock->pq);
@@ -915,11 +1255,19 @@ grub_net_recv_tcp_packet (struct grub_net_buff *nb,
 	  if ((nb_top->tail - nb_top->data) > 0)
 	    {
 	      grub_net_put_packet (&sock->packs, nb_top);
-	      do_ack = 1;
+	      if (!sock->ack_pending++)
+		sock->ack_deadline = (grub_get_time_ms ()
+				      + TCP_DELAYED_ACK_TIMEOUT);
 	    }
 	  else
-	    grub_netbuff_free (nb);
+	    grub_netbuff_free (nb_top);
 	}
+      tcp_sack_trim (sock);
+      /* Acknowledge filled holes at once, other data every
+	 TCP_DELAYED_ACK_SEGMENTS segments or from grub_net_tcp_retransmit
+	 when the delay expires.  */
+      if (had_sack || sock->ack_pending >= TCP_DELAYED_ACK_SEGMENTS)
+	do_ack = 1;
       if (do_ack)
 	ack (sock);
       while (sock->packs.first)
@@ -958,7 +1306,9 @@ grub_net_recv_tcp_packet (struct grub_net_buff *nb,
 	sock->their_start_seq = grub_be_to_cpu32 (tcph->seqnr);
 	sock->their_cur_seq = sock->their_start_seq + 1;
 	sock->my_cur_seq = sock->my_start_seq = grub_get_time_ms ();
-	sock->my_window = 8192;
+	sock->my_window = tcp_receive_window ();
+	sock->my_window_shift = tcp_window_shift (sock->my_window);
+	tcp_parse_syn_options (sock, tcph);
 
 	sock->pq = grub_priority_queue_new (sizeof (struct grub_net_buff *),
 					    cmp);
@@ -27,6 +27,7 @@
 #include <grub/file.h>
 #include <grub/priority_queue.h>
 #include <grub/i18n.h>
+#include <grub/env.h>
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
@@ -42,6 +43,13 @@ enum
 enum
   {
     TFTP_DEFAULTSIZE_PACKET = 512,
+    /* Block size retried with when larger blocks don't get through.  */
+    TFTP_FALLBACK_BLKSIZE = 1024,
+    TFTP_MAX_BLKSIZE = 65464,
+    TFTP_DEFAULT_WINDOWSIZE = 16,
+    TFTP_MAX_WINDOWSIZE = 64,
+    /* Intervals to wait for the first block before falling back.  */
+    TFTP_PROBE_TRIES = 4
   };
 
 enum
@@ -102,8 +110,12 @@ typedef struct tftp_data
   grub_uint64_t file_size;
   grub_uint64_t block;
   grub_uint32_t block_size;
-  grub_uint32_t ack_sent;
+  grub_uint32_t window_size;
+  grub_uint64_t ack_sent;
   int have_oack;
+  int have_data;
+  /* A lost block was reported for the current value of block.  */
+  int gap_acked;
   struct grub_error_saved save_err;
   grub_net_udp_socket_t sock;
   grub_priority_queue_t pq;
@@ -116,14 +128,25 @@ cmp (const void *a__, const void *b__)
   struct grub_net_buff *b_ = *(struct grub_net_buff **) b__;
   struct tftphdr *a = (struct tftphdr *) a_->data;
   struct tftphdr *b = (struct tftphdr *) b_->data;
-  /* We want the first elements to be on top.  */
-  if (grub_be_to_cpu16 (a->u.data.block) < grub_be_to_cpu16 (b->u.data.block))
+  grub_int16_t diff;
+  /* We want the first elements to be on top.  Block numbers wrap around,
+     but those in the queue are never more than a window apart.  */
+  diff = grub_be_to_cpu16 (a->u.data.block) - grub_be_to_cpu16 (b->u.data.block);
+  if (diff < 0)
     return +1;
-  if (grub_be_to_cpu16 (a->u.data.block) > grub_be_to_cpu16 (b->u.data.block))
+  if (diff > 0)
     return -1;
   return 0;
 }
 
+/* Position of the 16-bit BLOCK relative to the next expected block:
+   0 for the next one, negative for old ones.  */
+static grub_int16_t
+block_offset (tftp_data_t data, grub_uint16_t block)
+{
+  return (grub_int16_t) (block - (grub_uint16_t) (data->block + 1));
+}
+
 static grub_err_t
 ack (tftp_data_t data, grub_uint16_t block)
 {
@@ -148,7 +171,7 @@ ack (tftp_data_t data, grub_uint16_t block)
   err = grub_net_send_udp_packet (data->sock, &nb_ack);
   if (err)
     return err;
-  data->ack_sent = block;
+  data->ack_sent = data->block - (grub_uint16_t) (data->block - block);
   return GRUB_ERR_NONE;
 }
 
@@ -174,6 +197,7 @@ tftp_receive (grub_net_udp_socket_t sock __attribute__ ((unused)),
     {
     case TFTP_OACK:
       data->block_size = TFTP_DEFAULTSIZE_PACKET;
+      data->window_size = 1;
       data->have_oack = 1; 
       for (ptr = nb->data + sizeof (tftph->opcode); ptr < nb->tail;)
 	{
@@ -183,6 +207,10 @@ tftp_receive (grub_net_udp_socket_t sock __attribute__ ((unused)),
 	  if (grub_memcmp (ptr, "blksize\0", sizeof ("blksize\0") - 1) == 0)
 	    data->block_size = grub_strtoul ((char *) ptr + sizeof ("blksize\0")
 					     - 1, 0, 0);
+	  if (grub_memcmp (ptr, "windowsize\0", sizeof ("windowsize\0") - 1) == 0)
+	    data->window_size = grub_strtoul ((char *) ptr
+					      + sizeof ("windowsize\0") - 1,
+					      0, 0);
 	  while (ptr < nb->tail && *ptr)
 	    ptr++;
 	  ptr++;
@@ -213,27 +241,32 @@ tftp_receive (grub_net_udp_socket_t sock __attribute__ ((unused)),
 	      return GRUB_ERR_NONE;
 	    nb_top = *nb_top_p;
 	    tftph = (struct tftphdr *) nb_top->data;
-	    if (grub_be_to_cpu16 (tftph->u.data.block) >= data->block + 1)
+	    if (block_offset (data, grub_be_to_cpu16 (tftph->u.data.block)) >= 0)
 	      break;
 	    grub_netbuff_free (nb_top);
 	    grub_priority_queue_pop (data->pq);
 	  }
-	if (grub_be_to_cpu16 (tftph->u.data.block) == data->block + 1)
+	/* A block is missing.  Acknowledging the last one in sequence makes
+	   the server resend the window from there at once rather than after
+	   its timeout.  The blocks queued meanwhile are kept.  */
+	if (block_offset (data, grub_be_to_cpu16 (tftph->u.data.block)) != 0)
+	  {
+	    if (data->window_size > 1 && !data->gap_acked
+		&& file->device->net->packs.count < 50)
+	      {
+		data->gap_acked = 1;
+		return ack (data, data->block);
+	      }
+	    return GRUB_ERR_NONE;
+	  }
+	while (nb_top_p
+	       && block_offset (data,
+				grub_be_to_cpu16 (tftph->u.data.block)) == 0)
 	  {
 	    unsigned size;
 
 	    grub_priority_queue_pop (data->pq);
 
-	    if (file->device->net->packs.count < 50)
-	      err = ack (data, data->block + 1);
-	    else
-	      {
-		file->device->net->stall = 1;
-		err = 0;
-	      }
-	    if (err)
-	      return err;
-
 	    err = grub_netbuff_pull (nb_top, sizeof (tftph->opcode) +
 				     sizeof (tftph->u.data.block));
 	    if (err)
@@ -241,6 +274,8 @@ tftp_receive (grub_net_udp_socket_t sock __attribute__ ((unused)),
 	    size = nb_top->tail - nb_top->data;
 
 	    data->block++;
+	    data->have_data = 1;
+	    data->gap_acked = 0;
 	    if (size < data->block_size)
 	      {
 		if (data->ack_sent < data->block)
@@ -264,7 +299,24 @@ tftp_receive (grub_net_udp_socket_t sock __attribute__ ((unused)),
 	      grub_net_put_packet (&file->device->net->packs, nb_top);
 	    else
 	      grub_netbuff_free (nb_top);
+
+	    if (!data->sock)
+	      return GRUB_ERR_NONE;
+
+	    nb_top_p = grub_priority_queue_top (data->pq);
+	    if (nb_top_p)
+	      {
+		nb_top = *nb_top_p;
+		tftph = (struct tftphdr *) nb_top->data;
+	      }
 	  }
+
+	/* The server sends window_size blocks after each acknowledgement
+	   and waits for the next one.  */
+	if (file->device->net->packs.count >= 50)
+	  file->device->net->stall = 1;
+	else if (data->block - data->ack_sent >= data->window_size)
+	  return ack (data, data->block);
       }
       return GRUB_ERR_NONE;
     case TFTP_ERROR:
@@ -292,6 +344,62 @@ destroy_pq (tftp_data_t data)
   grub_priority_queue_destroy (data->pq);
 }
 
+static void
+tftp_abort (tftp_data_t data)
+{
+  grub_uint8_t nbdata[512];
+  grub_err_t err;
+  struct grub_net_buff nb_err;
+  struct tftphdr *tftph;
+
+  nb_err.head = nbdata;
+  nb_err.end = nbdata + sizeof (nbdata);
+
+  grub_netbuff_clear (&nb_err);
+  grub_netbuff_reserve (&nb_err, 512);
+  err = grub_netbuff_push (&nb_err, sizeof (tftph->opcode)
+			   + sizeof (tftph->u.err.errcode)
+			   + sizeof ("closed"));
+  if (!err)
+    {
+      tftph = (struct tftphdr *) nb_err.data;
+      tftph->opcode = grub_cpu_to_be16 (TFTP_ERROR);
+      tftph->u.err.errcode = grub_cpu_to_be16 (TFTP_EUNDEF);
+      grub_memcpy (tftph->u.err.errmsg, "closed", sizeof ("closed"));
+
+      err = grub_net_send_udp_packet (data->sock, &nb_err);
+    }
+  if (err)
+    grub_print_error ();
+  grub_net_udp_close (data->sock);
+  data->sock = NULL;
+}
+
+/* The largest block that fits in one frame on the way to ADDR.  */
+static grub_uint32_t
+tftp_path_blksize (grub_net_network_level_address_t addr)
+{
+  struct grub_net_network_level_interface *inf;
+  grub_net_network_level_address_t gateway;
+  grub_ssize_t size;
+
+  if (grub_net_route_address (addr, &gateway, &inf))
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return TFTP_FALLBACK_BLKSIZE;
+    }
+  if (addr.type == GRUB_NET_NETWORK_LEVEL_PROTOCOL_IPV4)
+    size = inf->card->mtu - GRUB_NET_OUR_IPV4_HEADER_SIZE;
+  else
+    size = 1280 - GRUB_NET_OUR_IPV6_HEADER_SIZE;
+  size -= GRUB_NET_UDP_HEADER_SIZE + 4;
+  if (size < TFTP_DEFAULTSIZE_PACKET)
+    return TFTP_DEFAULTSIZE_PACKET;
+  if (size > TFTP_MAX_BLKSIZE)
+    return TFTP_MAX_BLKSIZE;
+  return size;
+}
+
 static grub_err_t
 tftp_open (struct grub_file *file, const char *filename)
 {
@@ -306,55 +414,14 @@ tftp_open (struct grub_file *file, const char *filename)
   grub_err_t err;
   grub_uint8_t *nbd;
   grub_net_network_level_address_t addr;
+  grub_uint32_t blksize, windowsize = TFTP_DEFAULT_WINDOWSIZE;
+  const char *val;
+  char optval[sizeof ("XXXXXXXXXX")];
 
   data = grub_zalloc (sizeof (*data));
   if (!data)
     return grub_errno;
 
-  nb.head = open_data;
-  nb.end = open_data + sizeof (open_data);
-  grub_netbuff_clear (&nb);
-
-  grub_netbuff_reserve (&nb, 1500);
-  err = grub_netbuff_push (&nb, sizeof (*tftph));
-  if (err)
-    return err;
-
-  tftph = (struct tftphdr *) nb.data;
-
-  rrq = (char *) tftph->u.rrq;
-  rrqlen = 0;
-
-  tftph->opcode = grub_cpu_to_be16 (TFTP_RRQ);
-  grub_strcpy (rrq, filename);
-  rrqlen += grub_strlen (filename) + 1;
-  rrq += grub_strlen (filename) + 1;
-
-  grub_strcpy (rrq, "octet");
-  rrqlen += grub_strlen ("octet") + 1;
-  rrq += grub_strlen ("octet") + 1;
-
-  grub_strcpy (rrq, "blksize");
-  rrqlen += grub_strlen ("blksize") + 1;
-  rrq += grub_strlen ("blksize") + 1;
-
-  grub_strcpy (rrq, "1024");
-  rrqlen += grub_strlen ("1024") + 1;
-  rrq += grub_strlen ("1024") + 1;
-
-  grub_strcpy (rrq, "tsize");
-  rrqlen += grub_strlen ("tsize") + 1;
-  rrq += grub_strlen ("tsize") + 1;
-
-  grub_strcpy (rrq, "0");
-  rrqlen += grub_strlen ("0") + 1;
-  rrq += grub_strlen ("0") + 1;
-  hdrlen = sizeof (tftph->opcode) + rrqlen;
-
-  err = grub_netbuff_unput (&nb, nb.tail - (nb.data + hdrlen));
-  if (err)
-    return err;
-
   file->not_easily_seekable = 1;
   file->data = data;
 
@@ -369,41 +436,144 @@ tftp_open (struct grub_file *file, const char *filename)
       return err;
     }
 
-  data->sock = grub_net_udp_open (addr,
-				  TFTP_SERVER_PORT, tftp_receive,
-				  file);
-  if (!data->sock)
+  val = grub_env_get ("net_tftp_windowsize");
+  if (val)
     {
-      destroy_pq (data);
-      return grub_errno;
+      windowsize = grub_strtoul (val, 0, 0);
+      grub_errno = GRUB_ERR_NONE;
+      if (windowsize < 1)
+	windowsize = 1;
+      if (windowsize > TFTP_MAX_WINDOWSIZE)
+	windowsize = TFTP_MAX_WINDOWSIZE;
     }
 
-  /* Receive OACK packet.  */
-  nbd = nb.data;
-  for (i = 0; i < GRUB_NET_TRIES; i++)
+  /* Ask for blocks filling the MTU.  If the server accepts them but none
+     arrives, they are likely dropped on the way, so start over with
+     smaller ones.  */
+  blksize = tftp_path_blksize (addr);
+  while (1)
     {
-      nb.data = nbd;
-      err = grub_net_send_udp_packet (data->sock, &nb);
+      nb.head = open_data;
+      nb.end = open_data + sizeof (open_data);
+      grub_netbuff_clear (&nb);
+
+      grub_netbuff_reserve (&nb, 1500);
+      err = grub_netbuff_push (&nb, sizeof (*tftph));
+      if (err)
+	{
+	  destroy_pq (data);
+	  return err;
+	}
+
+      tftph = (struct tftphdr *) nb.data;
+
+      rrq = (char *) tftph->u.rrq;
+      rrqlen = 0;
+
+      tftph->opcode = grub_cpu_to_be16 (TFTP_RRQ);
+      grub_strcpy (rrq, filename);
+      rrqlen += grub_strlen (filename) + 1;
+      rrq += grub_strlen (filename) + 1;
+
+      grub_strcpy (rrq, "octet");
+      rrqlen += grub_strlen ("octet") + 1;
+      rrq += grub_strlen ("octet") + 1;
+
+      grub_strcpy (rrq, "blksize");
+      rrqlen += grub_strlen ("blksize") + 1;
+      rrq += grub_strlen ("blksize") + 1;
+
+      grub_snprintf (optval, sizeof (optval), "%u", blksize);
+      grub_strcpy (rrq, optval);
+      rrqlen += grub_strlen (optval) + 1;
+      rrq += grub_strlen (optval) + 1;
+
+      grub_strcpy (rrq, "windowsize");
+      rrqlen += grub_strlen ("windowsize") + 1;
+      rrq += grub_strlen ("windowsize") + 1;
+
+      grub_snprintf (optval, sizeof (optval), "%u", windowsize);
+      grub_strcpy (rrq, optval);
+      rrqlen += grub_strlen (optval) + 1;
+      rrq += grub_strlen (optval) + 1;
+
+      grub_strcpy (rrq, "tsize");
+      rrqlen += grub_strlen ("tsize") + 1;
+      rrq += grub_strlen ("tsize") + 1;
+
+      grub_strcpy (rrq, "0");
+      rrqlen += grub_strlen ("0") + 1;
+      rrq += grub_strlen ("0") + 1;
+      hdrlen = sizeof (tftph->opcode) + rrqlen;
+
+      err = grub_netbuff_unput (&nb, nb.tail - (nb.data + hdrlen));
       if (err)
 	{
-	  grub_net_udp_close (data->sock);
 	  destroy_pq (data);
 	  return err;
 	}
-      grub_net_poll_cards (GRUB_NET_INTERVAL, &data->have_oack);
-      if (data->have_oack)
+
+      data->sock = grub_net_udp_open (addr,
+				      TFTP_SERVER_PORT, tftp_receive,
+				      file);
+      if (!data->sock)
+	{
+	  destroy_pq (data);
+	  return grub_errno;
+	}
+
+      /* Receive OACK packet.  */
+      nbd = nb.data;
+      for (i = 0; i < GRUB_NET_TRIES; i++)
+	{
+	  nb.data = nbd;
+	  err = grub_net_send_udp_packet (data->sock, &nb);
+	  if (err)
+	    {
+	      grub_net_udp_close (data->sock);
+	      destroy_pq (data);
+	      return err;
+	    }
+	  grub_net_poll_cards (GRUB_NET_INTERVAL, &data->have_oack);
+	  if (data->have_oack)
+	    break;
+	}
+
+      if (!data->have_oack)
+	grub_error (GRUB_ERR_TIMEOUT, N_("time out opening `%s'"), filename);
+      else
+	grub_error_load (&data->save_err);
+      if (grub_errno)
+	{
+	  grub_net_udp_close (data->sock);
+	  destroy_pq (data);
+	  return grub_errno;
+	}
+
+      if (data->block_size <= TFTP_FALLBACK_BLKSIZE)
 	break;
-    }
 
-  if (!data->have_oack)
-    grub_error (GRUB_ERR_TIMEOUT, N_("time out opening `%s'"), filename);
-  else
-    grub_error_load (&data->save_err);
-  if (grub_errno)
-    {
-      grub_net_udp_close (data->sock);
-      destroy_pq (data);
-      return grub_errno;
+      for (i = 0; i < TFTP_PROBE_TRIES && !data->have_data
+	     && !file->device->net->eof; i++)
+	grub_net_poll_cards (GRUB_NET_INTERVAL, &data->have_data);
+      if (data->have_data || file->device->net->eof)
+	break;
+
+      grub_dprintf ("tftp", "no block of %u bytes received, retrying with %u\n",
+		    data->block_size, TFTP_FALLBACK_BLKSIZE);
+      tftp_abort (data);
+      while (grub_priority_queue_top (data->pq))
+	{
+	  grub_netbuff_free (*(struct grub_net_buff **)
+			     grub_priority_queue_top (data->pq));
+	  grub_priority_queue_pop (data->pq);
+	}
+      data->file_size = 0;
+      data->block = 0;
+      data->ack_sent = 0;
+      data->have_oack = 0;
+      data->gap_acked = 0;
+      blksize = TFTP_FALLBACK_BLKSIZE;
     }
 
   file->size = data->file_size;
@@ -417,33 +587,7 @@ tftp_close (struct grub_file *file)
   tftp_data_t data = file->data;
 
   if (data->sock)
-    {
-      grub_uint8_t nbdata[512];
-      grub_err_t err;
-      struct grub_net_buff nb_err;
-      struct tftphdr *tftph;
-
-      nb_err.head = nbdata;
-      nb_err.end = nbdata + sizeof (nbdata);
-
-      grub_netbuff_clear (&nb_err);
-      grub_netbuff_reserve (&nb_err, 512);
-      err = grub_netbuff_push (&nb_err, sizeof (tftph->opcode)
-			       + sizeof (tftph->u.err.errcode)
-			       + sizeof ("closed"));
-      if (!err)
-	{
-	  tftph = (struct tftphdr *) nb_err.data;
-	  tftph->opcode = grub_cpu_to_be16 (TFTP_ERROR);
-	  tftph->u.err.errcode = grub_cpu_to_be16 (TFTP_EUNDEF);
-	  grub_memcpy (tftph->u.err.errmsg, "closed", sizeof ("closed"));
-
-	  err = grub_net_send_udp_packet (data->sock, &nb_err);
-	}
-      if (err)
-	grub_print_error ();
-      grub_net_udp_close (data->sock);
-    }
+    tftp_abort (data);
   destroy_pq (data);
   grub_free (data);
   return GRUB_ERR_NONE;
@@ -458,7 +602,9 @@ tftp_packets_pulled (struct grub_file *file)
 
   if (!file->device->net->eof)
     file->device->net->stall = 0;
-  if (data->ack_sent >= data->block)
+  /* Send the acknowledgement held back while the reader was behind.  */
+  if (data->ack_sent >= data->block
+      || data->block - data->ack_sent < data->window_size)
     return 0;
   return ack (data, data->block);
 }
@@ -40,14 +40,27 @@ struct grub_net_udp_socket
   struct grub_net_network_level_interface *inf;
 };
 
-static struct grub_net_udp_socket *udp_sockets;
+/* Sockets are hashed by local port, which is unique per socket.  The
+   remote port can't be part of the key as it's only learnt from the first
+   reply.  */
+#define UDP_HASH_BITS 4
+#define UDP_HASH_SIZE (1 << UDP_HASH_BITS)
 
-#define FOR_UDP_SOCKETS(var) for (var = udp_sockets; var; var = var->next)
+static struct grub_net_udp_socket *udp_sockets[UDP_HASH_SIZE];
+
+static inline struct grub_net_udp_socket **
+udp_hash_bucket (int in_port)
+{
+  return &udp_sockets[grub_net_hash_bits (in_port, UDP_HASH_BITS)];
+}
+
+#define FOR_UDP_SOCKETS_ON_PORT(var, port) \
+  for (var = *udp_hash_bucket (port); var; var = var->next)
 
 static inline void
 udp_socket_register (grub_net_udp_socket_t sock)
 {
-  grub_list_push (GRUB_AS_LIST_P (&udp_sockets),
+  grub_list_push (GRUB_AS_LIST_P (udp_hash_bucket (sock->in_port)),
 		  GRUB_AS_LIST (sock));
 }
 
@@ -160,7 +173,7 @@ grub_net_recv_udp_packet (struct grub_net_buff *nb,
       return GRUB_ERR_NONE;
     }
 
-  FOR_UDP_SOCKETS (sock)
+  FOR_UDP_SOCKETS_ON_PORT (sock, grub_be_to_cpu16 (udph->dst))
   {
     if (grub_be_to_cpu16 (udph->dst) == sock->in_port
 	&& inf == sock->inf
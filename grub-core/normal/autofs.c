@@ -1,4 +1,4 @@
-/* autofs.c - support auto-loading from fs.lst */
+/* autofs.c - support auto-loading from fs.lst and fssig.lst */
 /*
  *  GRUB  --  GRand Unified Bootloader
  *  Copyright (C) 2009  Free Software Foundation, Inc.
@@ -23,16 +23,41 @@
 #include <grub/misc.h>
 #include <grub/fs.h>
 #include <grub/normal.h>
+#include <grub/bufio.h>
 
 /* This is used to store the names of filesystem modules for auto-loading.  */
 static grub_named_list_t fs_module_list;
 
-/* The auto-loading hook for filesystems.  */
+/* A filesystem signature from fssig.lst.  */
+struct fs_signature
+{
+  struct fs_signature *next;
+  grub_uint64_t offset;
+  grub_size_t size;
+  int failed;
+  char *module;
+  char magic[0];
+};
+
+static struct fs_signature *fs_signature_list;
+
+/* Return nonzero if NAME has signatures in fssig.lst.  Such modules are
+   loaded by autoload_fs_module_by_signature when they match.  */
 static int
-autoload_fs_module (void)
+has_signature (const char *name)
 {
-  grub_named_list_t p;
-  int ret = 0;
+  struct fs_signature *sig;
+
+  for (sig = fs_signature_list; sig; sig = sig->next)
+    if (grub_strcmp (sig->module, name) == 0)
+      return 1;
+  return 0;
+}
+
+static grub_dl_t
+load_fs_module (const char *name)
+{
+  grub_dl_t mod;
   grub_file_filter_t grub_file_filters_was[GRUB_FILE_FILTER_MAX];
 
   grub_memcpy (grub_file_filters_was, grub_file_filters_enabled,
@@ -40,9 +65,25 @@ autoload_fs_module (void)
   grub_memcpy (grub_file_filters_enabled, grub_file_filters_all,
 	       sizeof (grub_file_filters_enabled));
 
+  mod = grub_dl_load (name);
+
+  grub_memcpy (grub_file_filters_enabled, grub_file_filters_was,
+	       sizeof (grub_file_filters_enabled));
+
+  return mod;
+}
+
+/* The auto-loading hook for filesystems.  */
+static int
+autoload_fs_module (void)
+{
+  grub_named_list_t p;
+  int ret = 0;
+
   while ((p = fs_module_list) != NULL)
     {
-      if (! grub_dl_get (p->name) && grub_dl_load (p->name))
+      if (! grub_dl_get (p->name) && ! has_signature (p->name)
+	  && load_fs_module (p->name))
 	{
 	  ret = 1;
 	  break;
@@ -56,12 +97,134 @@ autoload_fs_module (void)
       grub_free (p);
     }
 
-  grub_memcpy (grub_file_filters_enabled, grub_file_filters_was,
-	       sizeof (grub_file_filters_enabled));
-
   return ret;
 }
 
+/* The auto-loading hook for filesystems with signatures.  */
+static int
+autoload_fs_module_by_signature (grub_device_t device)
+{
+  struct fs_signature *sig;
+
+  for (sig = fs_signature_list; sig; sig = sig->next)
+    {
+      if (sig->failed || grub_dl_get (sig->module)
+	  || ! grub_fs_check_signature (device->disk, sig->offset,
+					sig->magic, sig->size))
+	continue;
+
+      if (load_fs_module (sig->module))
+	return 1;
+
+      grub_print_error ();
+      sig->failed = 1;
+    }
+
+  return 0;
+}
+
+/* Parse a line "OFFSET MAGIC MODULE" of fssig.lst, where MAGIC may
+   contain \xHH escapes.  */
+static struct fs_signature *
+parse_fs_signature (const char *line)
+{
+  struct fs_signature *sig;
+  const char *p = line;
+  const char *end;
+  grub_uint64_t offset;
+  grub_size_t size = 0;
+
+  offset = grub_strtoull (p, (char **) &p, 10);
+  if (grub_errno || *p != ' ')
+    return NULL;
+  p++;
+
+  end = p;
+  while (*end && *end != ' ')
+    end++;
+  if (*end != ' ' || end == p)
+    return NULL;
+
+  sig = grub_malloc (sizeof (*sig) + (end - p) + grub_strlen (end + 1) + 1);
+  if (! sig)
+    return NULL;
+
+  while (p < end)
+    {
+      if (p[0] == '\\' && p[1] == 'x' && grub_isxdigit (p[2]))
+	{
+	  int val = 0, i;
+
+	  p += 2;
+	  for (i = 0; i < 2 && grub_isxdigit (*p); i++, p++)
+	    val = val * 16 + (grub_isdigit (*p) ? *p - '0'
+			      : grub_tolower (*p) - 'a' + 10);
+	  sig->magic[size++] = val;
+	}
+      else if (p[0] == '\\')
+	{
+	  grub_free (sig);
+	  return NULL;
+	}
+      else
+	sig->magic[size++] = *p++;
+    }
+
+  sig->offset = offset;
+  sig->size = size;
+  sig->failed = 0;
+  sig->module = sig->magic + size;
+  grub_strcpy (sig->module, end + 1);
+  return sig;
+}
+
+/* Read the file fssig.lst for auto-loading.  */
+static void
+read_fs_signature_list (const char *prefix)
+{
+  char *filename;
+  grub_file_t file;
+
+  while (fs_signature_list)
+    {
+      struct fs_signature *tmp;
+      tmp = fs_signature_list->next;
+      grub_free (fs_signature_list);
+      fs_signature_list = tmp;
+    }
+
+  filename = grub_xasprintf ("%s/" GRUB_TARGET_CPU "-" GRUB_PLATFORM
+			     "/fssig.lst", prefix);
+  if (! filename)
+    return;
+
+  file = grub_buffile_open (filename, 0);
+  grub_free (filename);
+  if (! file)
+    return;
+
+  while (1)
+    {
+      char *buf;
+      struct fs_signature *sig;
+
+      buf = grub_file_getline (file);
+      if (! buf)
+	break;
+
+      sig = parse_fs_signature (buf);
+      grub_free (buf);
+      grub_errno = GRUB_ERR_NONE;
+      if (! sig)
+	continue;
+
+      sig->next = fs_signature_list;
+      fs_signature_list = sig;
+    }
+
+  grub_file_close (file);
+}
+
 /* Read the file fs.lst for auto-loading.  */
 void
 read_fs_list (const char *prefix)
@@ -78,11 +241,13 @@ read_fs_list (const char *prefix)
 	  grub_fs_autoload_hook_t tmp_autoload_hook;
 
 	  /* This rules out the possibility that read_fs_list() is invoked
-	     recursively when we call grub_file_open() below.  */
+	     recursively when we call grub_buffile_open() below.  */
 	  tmp_autoload_hook = grub_fs_autoload_hook;
 	  grub_fs_autoload_hook = NULL;
 
-	  file = grub_file_open (filename);
+	  read_fs_signature_list (prefix);
+
+	  file = grub_buffile_open (filename, 0);
 	  if (file)
 	    {
 	      /* Override previous fs.lst.  */
@@ -152,6 +317,7 @@ read_fs_list (const char *prefix)
   /* Ignore errors.  */
   grub_errno = GRUB_ERR_NONE;
 
-  /* Set the hook.  */
+  /* Set the hooks.  */
   grub_fs_autoload_hook = autoload_fs_module;
+  grub_fs_autoload_device_hook = autoload_fs_module_by_signature;
 }
@@ -23,6 +23,7 @@
 #include <grub/misc.h>
 #include <grub/crypto.h>
 #include <grub/normal.h>
+#include <grub/bufio.h>
 
 struct load_spec
 {
@@ -94,7 +95,7 @@ read_crypto_list (const char *prefix)
       return;
     }
 
-  file = grub_file_open (filename);
+  file = grub_buffile_open (filename, 0);
   grub_free (filename);
   if (!file)
     {
@@ -23,6 +23,7 @@
 #include <grub/misc.h>
 #include <grub/command.h>
 #include <grub/normal.h>
+#include <grub/bufio.h>
 #include <grub/extcmd.h>
 #include <grub/script_sh.h>
 #include <grub/i18n.h>
@@ -106,28 +107,19 @@ read_command_list (const char *prefix)
 	{
 	  grub_file_t file;
 
-	  file = grub_file_open (filename);
+	  file = grub_buffile_open (filename, 0);
 	  if (file)
 	    {
 	      char *buf = NULL;
-	      grub_command_t ptr, last = 0, next;
+	      grub_command_t ptr, next;
 
 	      /* Override previous commands.lst.  */
-	      for (ptr = grub_command_list; ptr; ptr = next)
-		{
-		  next = ptr->next;
-		  if (ptr->flags & GRUB_COMMAND_FLAG_DYNCMD)
-		    {
-		      if (last)
-			last->next = ptr->next;
-		      else
-			grub_command_list = ptr->next;
-		      grub_free (ptr->data); /* extcmd struct */
-		      grub_free (ptr);
-		    }
-		  else
-		    last = ptr;
-		}
+	      FOR_COMMANDS_SAFE (ptr, next)
+		if (ptr->flags & GRUB_COMMAND_FLAG_DYNCMD)
+		  {
+		    grub_free (ptr->data); /* extcmd struct */
+		    grub_unregister_command (ptr);
+		  }
 
 	      for (;; grub_free (buf))
 		{
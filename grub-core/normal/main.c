@@ -22,6 +22,8 @@
 #include <grub/dl.h>
 #include <grub/misc.h>
 #include <grub/file.h>
+#include <grub/bufio.h>
+#include <grub/disk.h>
 #include <grub/mm.h>
 #include <grub/term.h>
 #include <grub/env.h>
@@ -40,7 +42,9 @@ GRUB_MOD_LICENSE ("GPLv3+");
 static int nested_level = 0;
 int grub_normal_exit_level = 0;
 
-/* Read a line from the file FILE.  */
+/* Read a line from the file FILE.  Nothing past the line is consumed, so
+   FILE is read a byte at a time; open it with grub_buffile_open to serve
+   those reads from memory.  */
 char *
 grub_file_getline (grub_file_t file)
 {
@@ -166,6 +170,8 @@ read_config_file (const char *config)
   char *old_file = 0, *old_dir = 0;
   char *config_dir, *ptr = 0;
   const char *ctmp;
+  char *text = 0;
+  grub_off_t size;
 
   grub_menu_t newmenu;
 
@@ -180,7 +186,7 @@ read_config_file (const char *config)
     }
 
   /* Try to open the config file.  */
-  file = grub_file_open (config);
+  file = grub_buffile_open (config, 0);
   if (! file)
     return 0;
 
@@ -202,20 +208,34 @@ read_config_file (const char *config)
   grub_env_export ("config_file");
   grub_env_export ("config_directory");
 
-  while (1)
+  /* Read the whole file so that its parsed statements can be reused the
+     next time the same contents are sourced.  */
+  size = grub_file_size (file);
+  if (size != GRUB_FILE_SIZE_UNKNOWN && size == (grub_size_t) size)
+    text = grub_malloc (size + 1);
+  if (text && grub_file_read (file, text, size) == (grub_ssize_t) size)
+    grub_script_execute_text (text, size, GRUB_SCRIPT_TEXT_CONFIG);
+  else
     {
-      char *line;
-
-      /* Print an error, if any.  */
-      grub_print_error ();
       grub_errno = GRUB_ERR_NONE;
+      grub_file_seek (file, 0);
 
-      if ((read_config_file_getline (&line, 0, file)) || (! line))
-	break;
+      while (1)
+	{
+	  char *line;
 
-      grub_normal_parse_line (line, read_config_file_getline, file);
-      grub_free (line);
+	  /* Print an error, if any.  */
+	  grub_print_error ();
+	  grub_errno = GRUB_ERR_NONE;
+
+	  if ((read_config_file_getline (&line, 0, file)) || (! line))
+	    break;
+
+	  grub_normal_parse_line (line, read_config_file_getline, file);
+	  grub_free (line);
+	}
     }
+  grub_free (text);
 
   if (old_file)
     grub_env_set ("config_file", old_file);
@@ -506,6 +526,14 @@ grub_env_write_pager (struct grub_env_var *var __attribute__ ((unused)),
   return grub_strdup (val);
 }
 
+static char *
+grub_env_write_readahead (struct grub_env_var *var __attribute__ ((unused)),
+			  const char *val)
+{
+  grub_disk_readahead_max = grub_strtoul (val, 0, 0) * 1024;
+  return grub_strdup (val);
+}
+
 /* clear */
 static grub_err_t
 grub_mini_cmd_clear (struct grub_command *cmd __attribute__ ((unused)),
@@ -557,6 +585,18 @@ GRUB_MOD_INIT(normal)
   grub_register_variable_hook ("pager", 0, grub_env_write_pager);
   grub_env_export ("pager");
 
+  /* Maximum disk readahead window in KiB.  */
+  {
+    char buf[sizeof ("XXXXXXXXXXXXXXXXXXXX")];
+
+    grub_snprintf (buf, sizeof (buf), "%lu",
+		   (unsigned long) (grub_disk_readahead_max / 1024));
+    grub_env_set ("disk_readahead_max", buf);
+    grub_register_variable_hook ("disk_readahead_max", 0,
+				 grub_env_write_readahead);
+    grub_env_export ("disk_readahead_max");
+  }
+
   /* Register a command "normal" for the rescue mode.  */
   grub_register_command ("normal", grub_cmd_normal,
 			 0, N_("Enter normal mode."));
@@ -599,6 +639,7 @@ GRUB_MOD_FINI(normal)
 
   grub_set_history (0);
   grub_register_variable_hook ("pager", 0, 0);
+  grub_register_variable_hook ("disk_readahead_max", 0, 0);
   grub_fs_autoload_hook = 0;
   grub_unregister_command (cmd_clear);
 }
@@ -23,6 +23,7 @@
 #include <grub/dl.h>
 #include <grub/env.h>
 #include <grub/normal.h>
+#include <grub/bufio.h>
 #include <grub/charset.h>
 #include <grub/i18n.h>
 
@@ -334,7 +335,7 @@ read_terminal_list (const char *prefix)
       return;
     }
 
-  file = grub_file_open (filename);
+  file = grub_buffile_open (filename, 0);
   grub_free (filename);
   if (!file)
     {
@@ -829,60 +829,360 @@ grub_script_function_call (grub_script_function_t func, int argc, char **args)
   return ret;
 }
 
-/* Helper for grub_script_execute_sourcecode.  */
+/* Source texts are parsed once into their top-level statements and the
+   trees are kept, keyed by the text itself, for the next time the same
+   menu entry, eval string or configuration file is run.  The size limit
+   counts the trees as well as the texts, as the trees are several times
+   larger.  */
+#define GRUB_SCRIPT_CACHE_SIZE		(512 * 1024)
+#define GRUB_SCRIPT_CACHE_ENTRIES	64
+
+struct grub_script_cached_stmt
+{
+  /* Offset of the statement in the text.  */
+  grub_size_t start;
+
+  /* The parsed statement, or NULL if it must be parsed again on every run
+     because it fails to parse or defines functions (which the parser,
+     not the execution, does).  */
+  struct grub_script *script;
+};
+
+struct grub_script_cached
+{
+  /* The next entry, in most recently used order.  */
+  struct grub_script_cached *next;
+
+  char *text;
+  grub_size_t len;
+  grub_uint32_t hash;
+  int flags;
+
+  /* Runs in progress, plus one while the entry is in the cache.  */
+  unsigned refcnt;
+
+  /* Bytes held by the parsed statements.  */
+  grub_size_t size;
+
+  grub_size_t nstmts;
+  grub_size_t allocated;
+  struct grub_script_cached_stmt *stmts;
+};
+
+static struct grub_script_cached *script_cache;
+static grub_size_t script_cache_size;
+static unsigned script_cache_entries;
+
+/* Where the line readers are in the text.  */
+struct grub_script_text_reader
+{
+  const char *pos;
+  const char *end;
+};
+
+/* Read a line of source code.  */
 static grub_err_t
 grub_script_execute_sourcecode_getline (char **line,
 					int cont __attribute__ ((unused)),
 					void *data)
 {
-  const char **source = data;
+  struct grub_script_text_reader *reader = data;
   const char *p;
 
-  if (! *source)
+  if (! reader->pos)
     {
       *line = 0;
       return 0;
     }
 
-  p = grub_strchr (*source, '\n');
+  p = grub_strchr (reader->pos, '\n');
 
   if (p)
-    *line = grub_strndup (*source, p - *source);
+    *line = grub_strndup (reader->pos, p - reader->pos);
   else
-    *line = grub_strdup (*source);
-  *source = p ? p + 1 : 0;
+    *line = grub_strdup (reader->pos);
+  reader->pos = p ? p + 1 : 0;
   return 0;
 }
 
-/* Execute a source script.  */
+/* Read a line of a configuration file the way grub_file_getline does,
+   skipping comment lines.  */
+static grub_err_t
+grub_script_execute_config_getline (char **line,
+				    int cont __attribute__ ((unused)),
+				    void *data)
+{
+  struct grub_script_text_reader *reader = data;
+
+  while (1)
+    {
+      const char *p;
+      char *out;
+
+      *line = 0;
+      if (reader->pos == reader->end)
+	return GRUB_ERR_NONE;
+
+      p = grub_memchr (reader->pos, '\n', reader->end - reader->pos);
+      if (! p)
+	p = reader->end;
+
+      out = grub_malloc (p - reader->pos + 1);
+      if (! out)
+	return grub_errno;
+      *line = out;
+
+      for (; reader->pos < p; reader->pos++)
+	if (*reader->pos != '\r')
+	  *out++ = *reader->pos;
+      *out = '\0';
+
+      if (p < reader->end)
+	reader->pos = p + 1;
+
+      if ((*line)[0] != '#')
+	return GRUB_ERR_NONE;
+      grub_free (*line);
+    }
+}
+
+static grub_uint32_t
+grub_script_cache_hash (const char *text, grub_size_t len)
+{
+  grub_uint32_t hash = 2166136261U;
+
+  while (len--)
+    hash = (hash ^ (grub_uint8_t) *text++) * 16777619;
+
+  return hash;
+}
+
+static void
+grub_script_cache_release (struct grub_script_cached *c)
+{
+  grub_size_t i;
+
+  if (--c->refcnt)
+    return;
+
+  for (i = 0; i < c->nstmts; i++)
+    grub_script_unref (c->stmts[i].script);
+  grub_free (c->stmts);
+  grub_free (c->text);
+  grub_free (c);
+}
+
+static struct grub_script_cached *
+grub_script_cache_find (const char *text, grub_size_t len,
+			grub_uint32_t hash, int flags)
+{
+  struct grub_script_cached **p, *c;
+
+  for (p = &script_cache; *p; p = &(*p)->next)
+    {
+      c = *p;
+      if (c->hash != hash || c->len != len || c->flags != flags
+	  || grub_memcmp (c->text, text, len) != 0)
+	continue;
+
+      /* Move it to the front.  */
+      *p = c->next;
+      c->next = script_cache;
+      script_cache = c;
+      return c;
+    }
+
+  return 0;
+}
+
+/* Put C, whose statements were parsed from TEXT, into the cache.  */
+static void
+grub_script_cache_insert (struct grub_script_cached *c, const char *text)
+{
+  grub_err_t saved_errno = grub_errno;
+
+  /* Count the text and the statement array as well.  */
+  c->size += c->len + c->allocated * sizeof (c->stmts[0]);
+  if (c->size > GRUB_SCRIPT_CACHE_SIZE
+      || grub_script_cache_find (text, c->len, c->hash, c->flags))
+    {
+      grub_script_cache_release (c);
+      return;
+    }
+
+  c->text = grub_malloc (c->len + 1);
+  if (! c->text)
+    {
+      grub_errno = saved_errno;
+      grub_script_cache_release (c);
+      return;
+    }
+  grub_memcpy (c->text, text, c->len);
+  c->text[c->len] = '\0';
+
+  c->next = script_cache;
+  script_cache = c;
+  script_cache_size += c->size;
+  script_cache_entries++;
+
+  /* Drop the least recently used entries.  */
+  while (script_cache_size > GRUB_SCRIPT_CACHE_SIZE
+	 || script_cache_entries > GRUB_SCRIPT_CACHE_ENTRIES)
+    {
+      struct grub_script_cached **p;
+
+      for (p = &script_cache; (*p)->next; p = &(*p)->next);
+      c = *p;
+      *p = 0;
+      script_cache_size -= c->size;
+      script_cache_entries--;
+      grub_script_cache_release (c);
+    }
+}
+
+/* Record the statement at START of C.  On failure, C is released and the
+   text is run without caching.  */
+static struct grub_script_cached *
+grub_script_cache_record (struct grub_script_cached *c, grub_size_t start,
+			  struct grub_script *script)
+{
+  if (! c)
+    return 0;
+
+  if (c->nstmts == c->allocated)
+    {
+      struct grub_script_cached_stmt *stmts;
+      grub_err_t saved_errno = grub_errno;
+
+      stmts = grub_realloc (c->stmts, (c->allocated ? c->allocated * 2 : 16)
+			    * sizeof (c->stmts[0]));
+      if (! stmts)
+	{
+	  grub_errno = saved_errno;
+	  grub_script_cache_release (c);
+	  return 0;
+	}
+      c->stmts = stmts;
+      c->allocated = c->allocated ? c->allocated * 2 : 16;
+    }
+
+  c->stmts[c->nstmts].start = start;
+  c->stmts[c->nstmts].script = grub_script_ref (script);
+  c->nstmts++;
+  if (script)
+    c->size += grub_script_size (script);
+  return c;
+}
+
+/* Execute the script TEXT of LEN bytes.  With GRUB_SCRIPT_TEXT_CONFIG,
+   TEXT is a configuration file: comment lines are skipped, and errors are
+   printed and cleared between statements.  */
 grub_err_t
-grub_script_execute_sourcecode (const char *source)
+grub_script_execute_text (const char *text, grub_size_t len, int flags)
 {
-  grub_err_t ret = 0;
-  struct grub_script *parsed_script;
+  struct grub_script_text_reader reader;
+  grub_reader_getline_t getline;
+  struct grub_script_cached *c;
+  grub_uint32_t hash;
+  grub_err_t ret = GRUB_ERR_NONE;
+  grub_size_t i = 0;
+
+  getline = ((flags & GRUB_SCRIPT_TEXT_CONFIG)
+	     ? grub_script_execute_config_getline
+	     : grub_script_execute_sourcecode_getline);
+
+  hash = grub_script_cache_hash (text, len);
+  c = grub_script_cache_find (text, len, hash, flags);
+  if (c)
+    {
+      c->refcnt++;
+      text = c->text;
+    }
+  else
+    {
+      c = grub_zalloc (sizeof (*c));
+      if (c)
+	{
+	  c->len = len;
+	  c->hash = hash;
+	  c->flags = flags;
+	  c->refcnt = 1;
+	}
+      else
+	grub_errno = GRUB_ERR_NONE;
+    }
+
+  reader.pos = text;
+  reader.end = text + len;
 
-  while (source)
+  while (1)
     {
       char *line;
+      struct grub_script *parsed_script;
+      unsigned generation;
+      grub_size_t start;
+
+      if (flags & GRUB_SCRIPT_TEXT_CONFIG)
+	{
+	  /* Print an error, if any.  */
+	  grub_print_error ();
+	  grub_errno = GRUB_ERR_NONE;
+	}
+
+      /* Run what is already parsed, if the text was in the cache.  */
+      if (c && c->text)
+	{
+	  if (i == c->nstmts)
+	    break;
+	  if (c->stmts[i].script)
+	    {
+	      ret = grub_script_execute (c->stmts[i++].script);
+	      continue;
+	    }
+	  reader.pos = text + c->stmts[i++].start;
+	}
+
+      start = reader.pos ? (grub_size_t) (reader.pos - text) : len;
+      if (getline (&line, 0, &reader) || ! line)
+	break;
 
-      grub_script_execute_sourcecode_getline (&line, 0, &source);
-      parsed_script = grub_script_parse
-	(line, grub_script_execute_sourcecode_getline, &source);
+      generation = grub_script_function_generation;
+      parsed_script = grub_script_parse (line, getline, &reader);
+      grub_free (line);
       if (! parsed_script)
 	{
 	  ret = grub_errno;
-	  grub_free (line);
+	  if (c && ! c->text)
+	    c = grub_script_cache_record (c, start, 0);
+	  if (flags & GRUB_SCRIPT_TEXT_CONFIG)
+	    continue;
 	  break;
 	}
 
+      if (c && ! c->text)
+	c = grub_script_cache_record (c, start,
+				      generation == grub_script_function_generation
+				      ? parsed_script : 0);
+
       ret = grub_script_execute (parsed_script);
-      grub_script_free (parsed_script);
-      grub_free (line);
+      grub_script_unref (parsed_script);
     }
 
+  if (c && c->text)
+    grub_script_cache_release (c);
+  else if (c)
+    grub_script_cache_insert (c, text);
+
   return ret;
 }
 
+/* Execute a source script.  */
+grub_err_t
+grub_script_execute_sourcecode (const char *source)
+{
+  return grub_script_execute_text (source, grub_strlen (source), 0);
+}
+
 /* Execute a source script in new scope.  */
 grub_err_t
 grub_script_execute_new_scope (const char *source, int argc, char **args)
@@ -23,6 +23,7 @@
 #include <grub/charset.h>
 
 grub_script_function_t grub_script_function_list;
+unsigned grub_script_function_generation;
 
 grub_script_function_t
 grub_script_function_create (struct grub_script_arg *functionname_arg,
@@ -31,6 +32,8 @@ grub_script_function_create (struct grub_script_arg *functionname_arg,
   grub_script_function_t func;
   grub_script_function_t *p;
 
+  grub_script_function_generation++;
+
   func = (grub_script_function_t) grub_malloc (sizeof (*func));
   if (! func)
     return 0;
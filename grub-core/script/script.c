@@ -34,6 +34,7 @@
 struct grub_script_mem
 {
   struct grub_script_mem *next;
+  grub_size_t size;
   char mem;
 };
 
@@ -47,6 +48,7 @@ grub_script_malloc (struct grub_parser_param *state, grub_size_t size)
   if (!mem)
     return 0;
 
+  mem->size = size + sizeof (*mem) - sizeof (char);
   grub_dprintf ("scripting", "malloc %p\n", mem);
   mem->next = state->memused;
   state->memused = mem;
@@ -90,6 +92,21 @@ grub_script_mem_record_stop (struct grub_parser_param *state,
   return mem;
 }
 
+/* Return the number of bytes allocated for SCRIPT and its children.  */
+grub_size_t
+grub_script_size (struct grub_script *script)
+{
+  struct grub_script_mem *mem;
+  struct grub_script *s;
+  grub_size_t size = sizeof (*script);
+
+  for (mem = script->mem; mem; mem = mem->next)
+    size += mem->size;
+  for (s = script->children; s; s = s->next_siblings)
+    size += grub_script_size (s);
+  return size;
+}
+
 /* Free the memory reserved for CMD and all of it's children.  */
 void
 grub_script_free (struct grub_script *script)
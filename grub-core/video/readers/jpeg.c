@@ -23,6 +23,7 @@
 #include <grub/mm.h>
 #include <grub/misc.h>
 #include <grub/bufio.h>
+#include <grub/time.h>
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
@@ -106,7 +107,7 @@ grub_jpeg_get_byte (struct grub_jpeg_data *data)
   grub_uint8_t r;
 
   r = 0;
-  grub_file_read (data->file, &r, 1);
+  grub_buffile_read (data->file, &r, 1);
 
   return r;
 }
@@ -117,7 +118,7 @@ grub_jpeg_get_word (struct grub_jpeg_data *data)
   grub_uint16_t r;
 
   r = 0;
-  grub_file_read (data->file, &r, sizeof (grub_uint16_t));
+  grub_buffile_read (data->file, &r, sizeof (grub_uint16_t));
 
   return grub_be_to_cpu16 (r);
 }
@@ -203,7 +204,7 @@ grub_jpeg_decode_huff_table (struct grub_jpeg_data *data)
 	return grub_error (GRUB_ERR_BAD_FILE_TYPE,
 			   "jpeg: too many huffman tables");
 
-      if (grub_file_read (data->file, &count, sizeof (count)) !=
+      if (grub_buffile_read (data->file, &count, sizeof (count)) !=
 	  sizeof (count))
 	return grub_errno;
 
@@ -216,7 +217,7 @@ grub_jpeg_decode_huff_table (struct grub_jpeg_data *data)
       if (grub_errno)
 	return grub_errno;
 
-      if (grub_file_read (data->file, data->huff_value[id], n) != n)
+      if (grub_buffile_read (data->file, data->huff_value[id], n) != n)
 	return grub_errno;
 
       base = 0;
@@ -260,8 +261,8 @@ grub_jpeg_decode_quan_table (struct grub_jpeg_data *data)
 	return grub_error (GRUB_ERR_BAD_FILE_TYPE,
 			   "jpeg: too many quantization tables");
 
-      if (grub_file_read (data->file, &data->quan_table[id],
-			  sizeof (data->quan_table[id]))
+      if (grub_buffile_read (data->file, &data->quan_table[id],
+			     sizeof (data->quan_table[id]))
 	  != sizeof (data->quan_table[id]))
 	return grub_errno;
 
@@ -782,15 +783,31 @@ grub_cmd_jpegtest (grub_command_t cmd __attribute__ ((unused)),
 		   int argc, char **args)
 {
   struct grub_video_bitmap *bitmap = 0;
+  unsigned long count = 1, i;
+  grub_uint64_t start;
 
-  if (argc != 1)
+  if (argc != 1 && argc != 2)
     return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("filename expected"));
 
-  grub_video_reader_jpeg (&bitmap, args[0]);
-  if (grub_errno != GRUB_ERR_NONE)
-    return grub_errno;
+  /* With a count, decode the file that many times and report the time
+     taken.  */
+  if (argc == 2)
+    count = grub_strtoul (args[1], 0, 0);
+
+  start = grub_get_time_ms ();
+  for (i = 0; i < count; i++)
+    {
+      grub_video_reader_jpeg (&bitmap, args[0]);
+      if (grub_errno != GRUB_ERR_NONE)
+	return grub_errno;
+
+      grub_video_bitmap_destroy (bitmap);
+      bitmap = 0;
+    }
 
-  grub_video_bitmap_destroy (bitmap);
+  if (argc == 2)
+    grub_printf ("%lu decodes in %llu ms\n", count,
+		 (unsigned long long) (grub_get_time_ms () - start));
 
   return GRUB_ERR_NONE;
 }
@@ -814,7 +831,7 @@ GRUB_MOD_INIT (jpeg)
   grub_video_bitmap_reader_register (&jpeg_reader);
 #if defined(JPEG_DEBUG)
   cmd = grub_register_command ("jpegtest", grub_cmd_jpegtest,
-			       "FILE", "Tests loading of JPEG bitmap.");
+			       "FILE [COUNT]", "Tests loading of JPEG bitmap.");
 #endif
 }
 
@@ -23,6 +23,7 @@
 #include <grub/mm.h>
 #include <grub/misc.h>
 #include <grub/bufio.h>
+#include <grub/time.h>
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
@@ -124,7 +125,7 @@ grub_png_get_dword (struct grub_png_data *data)
   grub_uint32_t r;
 
   r = 0;
-  grub_file_read (data->file, &r, sizeof (grub_uint32_t));
+  grub_buffile_read (data->file, &r, sizeof (grub_uint32_t));
 
   return grub_be_to_cpu32 (r);
 }
@@ -166,7 +167,7 @@ grub_png_get_byte (struct grub_png_data *data)
     }
 
   r = 0;
-  grub_file_read (data->file, &r, 1);
+  grub_buffile_read (data->file, &r, 1);
 
   if (data->inside_idat)
     data->idat_remain--;
@@ -838,7 +839,7 @@ grub_png_decode_png (struct grub_png_data *data)
 {
   grub_uint8_t magic[8];
 
-  if (grub_file_read (data->file, &magic[0], 8) != 8)
+  if (grub_buffile_read (data->file, &magic[0], 8) != 8)
     return grub_errno;
 
   if (grub_memcmp (magic, png_magic, sizeof (png_magic)))
@@ -930,15 +931,31 @@ grub_cmd_pngtest (grub_command_t cmd __attribute__ ((unused)),
 		  int argc, char **args)
 {
   struct grub_video_bitmap *bitmap = 0;
+  unsigned long count = 1, i;
+  grub_uint64_t start;
 
-  if (argc != 1)
+  if (argc != 1 && argc != 2)
     return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("filename expected"));
 
-  grub_video_reader_png (&bitmap, args[0]);
-  if (grub_errno != GRUB_ERR_NONE)
-    return grub_errno;
+  /* With a count, decode the file that many times and report the time
+     taken.  */
+  if (argc == 2)
+    count = grub_strtoul (args[1], 0, 0);
+
+  start = grub_get_time_ms ();
+  for (i = 0; i < count; i++)
+    {
+      grub_video_reader_png (&bitmap, args[0]);
+      if (grub_errno != GRUB_ERR_NONE)
+	return grub_errno;
+
+      grub_video_bitmap_destroy (bitmap);
+      bitmap = 0;
+    }
 
-  grub_video_bitmap_destroy (bitmap);
+  if (argc == 2)
+    grub_printf ("%lu decodes in %llu ms\n", count,
+		 (unsigned long long) (grub_get_time_ms () - start));
 
   return GRUB_ERR_NONE;
 }
@@ -955,7 +972,7 @@ GRUB_MOD_INIT (png)
   grub_video_bitmap_reader_register (&png_reader);
 #if defined(PNG_DEBUG)
   cmd = grub_register_command ("pngtest", grub_cmd_pngtest,
-			       "FILE",
+			       "FILE [COUNT]",
 			       "Tests loading of PNG bitmap.");
 #endif
 }
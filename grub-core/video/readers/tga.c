@@ -23,6 +23,7 @@
 #include <grub/mm.h>
 #include <grub/misc.h>
 #include <grub/bufio.h>
+#include <grub/time.h>
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
@@ -101,7 +102,7 @@ tga_load_truecolor_rle_R8G8B8 (struct grub_video_bitmap *bitmap,
 
       for (x = 0; x < header->image_width;)
         {
-          if (grub_file_read (file, &type, sizeof (type)) != sizeof(type))
+          if (grub_buffile_read (file, &type, sizeof (type)) != sizeof(type))
             return grub_errno;
 
           if (type & 0x80)
@@ -110,7 +111,7 @@ tga_load_truecolor_rle_R8G8B8 (struct grub_video_bitmap *bitmap,
               type &= 0x7f;
               type++;
 
-              if (grub_file_read (file, &tmp[0], bytes_per_pixel)
+              if (grub_buffile_read (file, &tmp[0], bytes_per_pixel)
                   != bytes_per_pixel)
                 return grub_errno;
 
@@ -135,7 +136,7 @@ tga_load_truecolor_rle_R8G8B8 (struct grub_video_bitmap *bitmap,
 
               while (type)
                 {
-                  if (grub_file_read (file, &tmp[0], bytes_per_pixel)
+                  if (grub_buffile_read (file, &tmp[0], bytes_per_pixel)
                       != bytes_per_pixel)
                     return grub_errno;
 
@@ -180,7 +181,7 @@ tga_load_truecolor_rle_R8G8B8A8 (struct grub_video_bitmap *bitmap,
 
       for (x = 0; x < header->image_width;)
         {
-          if (grub_file_read (file, &type, sizeof (type)) != sizeof(type))
+          if (grub_buffile_read (file, &type, sizeof (type)) != sizeof(type))
             return grub_errno;
 
           if (type & 0x80)
@@ -189,7 +190,7 @@ tga_load_truecolor_rle_R8G8B8A8 (struct grub_video_bitmap *bitmap,
               type &= 0x7f;
               type++;
 
-              if (grub_file_read (file, &tmp[0], bytes_per_pixel)
+              if (grub_buffile_read (file, &tmp[0], bytes_per_pixel)
                   != bytes_per_pixel)
                 return grub_errno;
 
@@ -215,7 +216,7 @@ tga_load_truecolor_rle_R8G8B8A8 (struct grub_video_bitmap *bitmap,
 
               while (type)
                 {
-                  if (grub_file_read (file, &tmp[0], bytes_per_pixel)
+                  if (grub_buffile_read (file, &tmp[0], bytes_per_pixel)
                       != bytes_per_pixel)
                     return grub_errno;
 
@@ -260,7 +261,7 @@ tga_load_truecolor_R8G8B8 (struct grub_video_bitmap *bitmap,
 
       for (x = 0; x < header->image_width; x++)
         {
-          if (grub_file_read (file, &tmp[0], bytes_per_pixel)
+          if (grub_buffile_read (file, &tmp[0], bytes_per_pixel)
               != bytes_per_pixel)
             return grub_errno;
 
@@ -297,7 +298,7 @@ tga_load_truecolor_R8G8B8A8 (struct grub_video_bitmap *bitmap,
 
       for (x = 0; x < header->image_width; x++)
         {
-          if (grub_file_read (file, &tmp[0], bytes_per_pixel)
+          if (grub_buffile_read (file, &tmp[0], bytes_per_pixel)
               != bytes_per_pixel)
             return grub_errno;
 
@@ -330,7 +331,7 @@ grub_video_reader_tga (struct grub_video_bitmap **bitmap,
      not going to support developer area & extensions at this point.  */
 
   /* Read TGA header from beginning of file.  */
-  if (grub_file_read (file, &header, sizeof (header))
+  if (grub_buffile_read (file, &header, sizeof (header))
       != sizeof (header))
     {
       grub_file_close (file);
@@ -457,15 +458,31 @@ grub_cmd_tgatest (grub_command_t cmd __attribute__ ((unused)),
                   int argc, char **args)
 {
   struct grub_video_bitmap *bitmap = 0;
+  unsigned long count = 1, i;
+  grub_uint64_t start;
 
-  if (argc != 1)
+  if (argc != 1 && argc != 2)
     return grub_error (GRUB_ERR_BAD_ARGUMENT, "file name required");
 
-  grub_video_reader_tga (&bitmap, args[0]);
-  if (grub_errno != GRUB_ERR_NONE)
-    return grub_errno;
+  /* With a count, decode the file that many times and report the time
+     taken.  */
+  if (argc == 2)
+    count = grub_strtoul (args[1], 0, 0);
+
+  start = grub_get_time_ms ();
+  for (i = 0; i < count; i++)
+    {
+      grub_video_reader_tga (&bitmap, args[0]);
+      if (grub_errno != GRUB_ERR_NONE)
+	return grub_errno;
+
+      grub_video_bitmap_destroy (bitmap);
+      bitmap = 0;
+    }
 
-  grub_video_bitmap_destroy (bitmap);
+  if (argc == 2)
+    grub_printf ("%lu decodes in %llu ms\n", count,
+		 (unsigned long long) (grub_get_time_ms () - start));
 
   return GRUB_ERR_NONE;
 }
@@ -482,7 +499,7 @@ GRUB_MOD_INIT(tga)
   grub_video_bitmap_reader_register (&tga_reader);
 #if defined(TGA_DEBUG)
   cmd = grub_register_command ("tgatest", grub_cmd_tgatest,
-                               "FILE", "Tests loading of TGA bitmap.");
+                               "FILE [COUNT]", "Tests loading of TGA bitmap.");
 #endif
 }
 
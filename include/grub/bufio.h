@@ -22,7 +22,42 @@
 
 #include <grub/file.h>
 
+struct grub_bufio
+{
+  grub_file_t file;
+  grub_size_t block_size;
+  grub_size_t buffer_len;
+  grub_off_t buffer_at;
+  char buffer[0];
+};
+typedef struct grub_bufio *grub_bufio_t;
+
 grub_file_t EXPORT_FUNC (grub_bufio_open) (grub_file_t io, int size);
 grub_file_t EXPORT_FUNC (grub_buffile_open) (const char *name, int size);
 
+/* Read LEN bytes from FILE, which must have been opened with
+   grub_bufio_open or grub_buffile_open, into BUF.  Small reads that the
+   buffer already holds are copied here without a call into the file
+   layer, which matters to parsers that read a byte at a time.  */
+static inline grub_ssize_t
+grub_buffile_read (grub_file_t file, void *buf, grub_size_t len)
+{
+  grub_bufio_t bufio = file->data;
+
+  if (file->offset >= bufio->buffer_at
+      && file->offset - bufio->buffer_at + len <= bufio->buffer_len)
+    {
+      const char *src = bufio->buffer + (file->offset - bufio->buffer_at);
+      char *dest = buf;
+      grub_size_t i;
+
+      for (i = 0; i < len; i++)
+	dest[i] = src[i];
+      file->offset += len;
+      return len;
+    }
+
+  return grub_file_read (file, buf, len);
+}
+
 #endif /* ! GRUB_BUFIO_H */
@@ -243,9 +243,29 @@ typedef struct gcry_pk_spec
 #endif
 } gcry_pk_spec_t;
 
+/* Bulk implementation of block ciphers, typically using special CPU
+   instructions.  Handles opened for one of NAMES use it for ECB and CBC
+   operations instead of going through the cipher spec block by block.  */
+struct grub_crypto_cipher_accel
+{
+  const char *const *names;
+  grub_size_t contextsize;
+  gcry_err_code_t (*setkey) (void *ctx, const unsigned char *key,
+			     unsigned keylen);
+  /* Process NBLOCKS blocks from IN to OUT, which may be the same.  */
+  void (*encrypt) (void *ctx, grub_uint8_t *out, const grub_uint8_t *in,
+		   grub_size_t nblocks);
+  void (*decrypt) (void *ctx, grub_uint8_t *out, const grub_uint8_t *in,
+		   grub_size_t nblocks);
+  struct grub_crypto_cipher_accel *next;
+};
+
 struct grub_crypto_cipher_handle
 {
   const struct gcry_cipher_spec *cipher;
+  /* The bulk implementation in use, if any, and its context.  */
+  const struct grub_crypto_cipher_accel *accel;
+  void *accel_ctx;
   char ctx[0];
 };
 
@@ -324,6 +344,15 @@ void
 grub_cipher_register (gcry_cipher_spec_t *cipher);
 void
 grub_cipher_unregister (gcry_cipher_spec_t *cipher);
+void
+grub_crypto_cipher_accel_register (struct grub_crypto_cipher_accel *accel);
+void
+grub_crypto_cipher_accel_unregister (struct grub_crypto_cipher_accel *accel);
+#if defined (__x86_64__) && defined (GRUB_MACHINE_EFI)
+/* Register the AES-NI bulk cipher if the CPU supports it.  Calling this
+   makes the aesni module a dependency of the caller.  */
+void grub_aesni_init (void);
+#endif
 void 
 grub_md_register (gcry_md_spec_t *digest);
 void 
@@ -94,6 +94,8 @@ struct grub_cryptodisk
   grub_uint8_t rekey_key[64];
   grub_uint64_t last_rekey;
   int rekey_derived_size;
+  /* Called once the device is unlocked and in the list of devices.  */
+  void (*unlocked) (struct grub_cryptodisk *dev);
 };
 typedef struct grub_cryptodisk *grub_cryptodisk_t;
 
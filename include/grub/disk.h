@@ -48,6 +48,8 @@ enum grub_disk_dev_id
     GRUB_DISK_DEVICE_PROCFS_ID,
     GRUB_DISK_DEVICE_CBFSDISK_ID,
     GRUB_DISK_DEVICE_UBOOTDISK_ID,
+    /* Must stay last.  */
+    GRUB_DISK_DEVICE_MAX_ID
   };
 
 struct grub_disk;
@@ -104,6 +106,9 @@ typedef struct grub_disk_dev *grub_disk_dev_t;
 
 extern grub_disk_dev_t EXPORT_VAR (grub_disk_dev_list);
 
+/* The maximum readahead window in bytes. 0 disables readahead.  */
+extern grub_size_t EXPORT_VAR (grub_disk_readahead_max);
+
 struct grub_partition;
 
 typedef void (*grub_disk_read_hook_t) (grub_disk_addr_t sector,
@@ -138,6 +143,12 @@ struct grub_disk
   /* Caller-specific data passed to the read hook.  */
   void *read_hook_data;
 
+  /* The sector following the last read, used to detect sequential access.  */
+  grub_disk_addr_t ra_next;
+
+  /* The current readahead window in cache units.  */
+  grub_size_t ra_window;
+
   /* Device-specific data.  */
   void *data;
 };
@@ -156,14 +167,26 @@ typedef struct grub_disk_memberlist *grub_disk_memberlist_t;
 #define GRUB_DISK_SECTOR_SIZE	0x200
 #define GRUB_DISK_SECTOR_BITS	9
 
-/* The maximum number of disk caches.  */
+/* The disk cache is GRUB_DISK_CACHE_WAYS-way set associative. The number of
+   sets is chosen from the heap size when the first disk is opened and is
+   GRUB_DISK_CACHE_NUM where the heap size is unknown.  */
 #define GRUB_DISK_CACHE_NUM	1021
+#define GRUB_DISK_CACHE_WAYS	4
+#define GRUB_DISK_CACHE_MIN_SETS	31
+#define GRUB_DISK_CACHE_MAX_SETS	4093
+/* At most this fraction of the heap is used for cached data.  */
+#define GRUB_DISK_CACHE_HEAP_FRACTION	4
 
 /* The size of a disk cache in 512B units. Must be at least as big as the
    largest supported sector size, currently 16K.  */
 #define GRUB_DISK_CACHE_BITS	6
 #define GRUB_DISK_CACHE_SIZE	(1 << GRUB_DISK_CACHE_BITS)
 
+/* The first readahead window in cache units. It doubles on every further
+   sequential miss up to grub_disk_readahead_max bytes.  */
+#define GRUB_DISK_READAHEAD_MIN	2
+#define GRUB_DISK_READAHEAD_MAX	(1024 * 1024)
+
 /* Return value of grub_disk_get_size() in case disk size is unknown. */
 #define GRUB_DISK_SIZE_UNKNOWN	 0xffffffffffffffffULL
 
@@ -204,6 +227,13 @@ grub_uint64_t EXPORT_FUNC(grub_disk_get_size) (grub_disk_t disk);
 #if DISK_CACHE_STATS
 void
 EXPORT_FUNC(grub_disk_cache_get_performance) (unsigned long *hits, unsigned long *misses);
+void
+EXPORT_FUNC(grub_disk_cache_get_dev_performance) (enum grub_disk_dev_id dev_id,
+						  unsigned long *hits,
+						  unsigned long *misses,
+						  unsigned long *entries);
+void
+EXPORT_FUNC(grub_disk_cache_get_geometry) (unsigned *sets, unsigned *ways);
 #endif
 
 extern void (* EXPORT_VAR(grub_disk_firmware_fini)) (void);
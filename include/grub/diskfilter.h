@@ -69,6 +69,11 @@ struct grub_diskfilter_pv {
   grub_disk_addr_t part_start;
   grub_disk_addr_t part_size;
   grub_disk_addr_t start_sector; /* Sector number where the data area starts. */
+  /* Smoothed read cost, used to choose between redundant copies.  */
+  grub_uint32_t read_cost;
+  /* Time and size of the reads not yet accounted for in read_cost.  */
+  grub_uint64_t read_time;
+  grub_uint64_t read_sectors;
   struct grub_diskfilter_pv *next;
   /* Optional.  */
   grub_uint8_t *internal_id;
@@ -45,6 +45,25 @@ typedef int (*grub_fs_dir_hook_t) (const char *filename,
 				   const struct grub_dirhook_info *info,
 				   void *data);
 
+/* A magic number which every instance of a filesystem has at OFFSET
+   bytes from the start of the device.  */
+struct grub_fs_signature
+{
+  grub_uint32_t offset;
+  grub_uint32_t size;
+  const char *magic;
+};
+
+/* Declare a signature.  OFFSET must be a plain number and MAGIC a single
+   string literal without spaces, since they are also collected into
+   fssig.lst at build time.  */
+#ifdef GRUB_LST_GENERATOR
+#define GRUB_FS_SIGNATURE(offset, magic) FS_SIGNATURE_MARKER (offset, magic)
+#else
+#define GRUB_FS_SIGNATURE(offset, magic) { (offset), sizeof (magic) - 1, (magic) }
+#endif
+#define GRUB_FS_SIGNATURE_END { 0, 0, 0 }
+
 /* Filesystem descriptor.  */
 struct grub_fs
 {
@@ -81,6 +100,11 @@ struct grub_fs
   /* Get writing time of filesystem. */
   grub_err_t (*mtime) (grub_device_t device, grub_int32_t *timebuf);
 
+  /* Optional.  Signatures of which at least one is present on every
+     device with this filesystem, terminated by GRUB_FS_SIGNATURE_END.
+     grub_fs_probe only tries the filesystem if one of them matches.  */
+  const struct grub_fs_signature *signatures;
+
 #ifdef GRUB_UTIL
   /* Determine sectors available for embedding.  */
   grub_err_t (*embed) (grub_device_t device, unsigned int *nsectors,
@@ -106,6 +130,12 @@ extern struct grub_fs grub_fs_blocklist;
    the linked list GRUB_FS_LIST through the function grub_fs_register.  */
 typedef int (*grub_fs_autoload_hook_t) (void);
 extern grub_fs_autoload_hook_t EXPORT_VAR(grub_fs_autoload_hook);
+
+/* Like grub_fs_autoload_hook, but only loads modules whose signatures
+   match DEVICE.  It is tried first.  */
+typedef int (*grub_fs_autoload_device_hook_t) (grub_device_t device);
+extern grub_fs_autoload_device_hook_t
+EXPORT_VAR(grub_fs_autoload_device_hook);
 extern grub_fs_t EXPORT_VAR (grub_fs_list);
 
 #ifndef GRUB_LST_GENERATOR
@@ -125,5 +155,9 @@ grub_fs_unregister (grub_fs_t fs)
 #define FOR_FILESYSTEMS(var) FOR_LIST_ELEMENTS((var), (grub_fs_list))
 
 grub_fs_t EXPORT_FUNC(grub_fs_probe) (grub_device_t device);
+int EXPORT_FUNC(grub_fs_check_signature) (struct grub_disk *disk,
+					  grub_uint64_t offset,
+					  const char *magic,
+					  grub_size_t size);
 
 #endif /* ! GRUB_FS_HEADER */
@@ -77,4 +77,25 @@ EXPORT_FUNC(grub_fshelp_read_file) (grub_disk_t disk, grub_fshelp_node_t node,
 				    grub_off_t filesize, int log2blocksize,
 				    grub_disk_addr_t blocks_start);
 
+/* Set *START to the disk block holding file block BLOCK of NODE and *LEN
+   to the number of blocks from there which are contiguous on disk.  A
+   *START of 0 means that the run is sparse.  *LEN may extend past the end
+   of the file.  */
+typedef grub_err_t (*grub_fshelp_get_extent_t) (grub_fshelp_node_t node,
+						grub_disk_addr_t block,
+						grub_disk_addr_t *start,
+						grub_disk_addr_t *len);
+
+grub_ssize_t
+EXPORT_FUNC(grub_fshelp_read_file_extents) (grub_disk_t disk,
+					    grub_fshelp_node_t node,
+					    grub_disk_read_hook_t read_hook,
+					    void *read_hook_data,
+					    grub_off_t pos, grub_size_t len,
+					    char *buf,
+					    grub_fshelp_get_extent_t get_extent,
+					    grub_off_t filesize,
+					    int log2blocksize,
+					    grub_disk_addr_t blocks_start);
+
 #endif /* ! GRUB_FSHELP_HEADER */
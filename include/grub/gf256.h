@@ -0,0 +1,59 @@
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GRUB_GF256_HEADER
+#define GRUB_GF256_HEADER	1
+
+#include <grub/types.h>
+
+/* Arithmetic in GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1,
+   as used by RAID6 and raidz.  */
+
+/* x**y.  */
+extern grub_uint8_t grub_gf256_powx[255 * 2];
+/* Such an s that x**s = y */
+extern int grub_gf256_powx_inv[256];
+/* Nonzero if the region functions may use SIMD kernels.  */
+extern int grub_gf256_simd;
+
+/* Fill the tables above.  Must be called before any other function.  */
+void grub_gf256_init (void);
+
+static inline grub_uint8_t
+grub_gf256_mul (grub_uint8_t a, grub_uint8_t b)
+{
+  if (a == 0 || b == 0)
+    return 0;
+  return grub_gf256_powx[grub_gf256_powx_inv[a] + grub_gf256_powx_inv[b]];
+}
+
+/* DST = SRC * C.  DST may be equal to SRC.  */
+void grub_gf256_mul_region (grub_uint8_t *dst, const grub_uint8_t *src,
+			    grub_size_t size, grub_uint8_t c);
+/* DST ^= SRC * C.  */
+void grub_gf256_mul_xor_region (grub_uint8_t *dst, const grub_uint8_t *src,
+				grub_size_t size, grub_uint8_t c);
+
+/* Byte at a time versions of the above, for reference.  */
+void grub_gf256_mul_region_table (grub_uint8_t *dst, const grub_uint8_t *src,
+				  grub_size_t size, grub_uint8_t c);
+void grub_gf256_mul_xor_region_table (grub_uint8_t *dst,
+				      const grub_uint8_t *src,
+				      grub_size_t size, grub_uint8_t c);
+
+#endif /* ! GRUB_GF256_HEADER */
@@ -128,7 +128,8 @@ struct grub_net_card
   grub_ssize_t new_ll_entry;
   struct grub_net_link_layer_entry *link_layer_table;
   void *txbuf;
-  void *rcvbuf;
+  /* Receive buffers, recycled as the stack frees them.  */
+  struct grub_net_buff_pool *rx_pool;
   grub_size_t rcvbufsize;
   grub_size_t txbufsize;
   int txbusy;
@@ -449,6 +450,16 @@ grub_net_hwaddr_cmp (const grub_net_link_level_address_t *a,
 int
 grub_net_addr_cmp (const grub_net_network_level_address_t *a,
 		   const grub_net_network_level_address_t *b);
+grub_uint32_t
+grub_net_addr_hash (const grub_net_network_level_address_t *a);
+
+/* Fold V into an index of BITS bits for the small hash tables used to
+   demultiplex incoming packets.  */
+static inline unsigned
+grub_net_hash_bits (grub_uint32_t v, unsigned bits)
+{
+  return (grub_uint32_t) (v * 0x9e3779b1) >> (32 - bits);
+}
 
 
 /*
@@ -523,5 +534,6 @@ extern char *grub_net_default_server;
 
 #define GRUB_NET_TRIES 40
 #define GRUB_NET_INTERVAL 400
+#define GRUB_NET_RX_POOL_SIZE 64
 
 #endif /* ! GRUB_NET_HEADER */
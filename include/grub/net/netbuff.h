@@ -6,6 +6,8 @@
 #define NETBUFF_ALIGN 2048
 #define NETBUFFMINLEN 64
 
+struct grub_net_buff_pool;
+
 struct grub_net_buff
 {
   /* Pointer to the start of the buffer.  */
@@ -16,6 +18,10 @@ struct grub_net_buff
   grub_uint8_t *tail;
   /* Pointer to the end of the buffer.  */
   grub_uint8_t *end;
+  /* Pool the buffer goes back to when freed, NULL if allocated alone.  */
+  struct grub_net_buff_pool *pool;
+  /* Next free buffer of the pool.  */
+  struct grub_net_buff *next_free;
 };
 
 grub_err_t grub_netbuff_put (struct grub_net_buff *net_buff, grub_size_t len);
@@ -26,5 +32,10 @@ grub_err_t grub_netbuff_reserve (struct grub_net_buff *net_buff, grub_size_t len
 grub_err_t grub_netbuff_clear (struct grub_net_buff *net_buff);
 struct grub_net_buff * grub_netbuff_alloc (grub_size_t len);
 void grub_netbuff_free (struct grub_net_buff *net_buff);
+struct grub_net_buff_pool *grub_netbuff_pool_new (grub_size_t len,
+						  unsigned count);
+struct grub_net_buff *
+grub_netbuff_pool_alloc (struct grub_net_buff_pool *pool, grub_size_t len);
+void grub_netbuff_pool_destroy (struct grub_net_buff_pool *pool);
 
 #endif
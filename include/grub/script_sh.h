@@ -293,6 +293,7 @@ struct grub_script *grub_script_parse (char *script,
 				       grub_reader_getline_t getline,
 				       void *getline_data);
 void grub_script_free (struct grub_script *script);
+grub_size_t grub_script_size (struct grub_script *script);
 struct grub_script *grub_script_create (struct grub_script_cmd *cmd,
 					struct grub_script_mem *mem);
 
@@ -330,6 +331,9 @@ grub_err_t grub_script_execute_cmdwhile (struct grub_script_cmd *cmd);
 /* Execute any GRUB pre-parsed command or script.  */
 grub_err_t grub_script_execute (struct grub_script *script);
 grub_err_t grub_script_execute_sourcecode (const char *source);
+#define GRUB_SCRIPT_TEXT_CONFIG	1
+grub_err_t grub_script_execute_text (const char *text, grub_size_t len,
+				     int flags);
 grub_err_t grub_script_execute_new_scope (const char *source, int argc, char **args);
 
 /* Break command for loops.  */
@@ -371,6 +375,9 @@ typedef struct grub_script_function *grub_script_function_t;
 
 extern grub_script_function_t grub_script_function_list;
 
+/* Incremented whenever a function is defined.  */
+extern unsigned grub_script_function_generation;
+
 #define FOR_SCRIPT_FUNCTIONS(var) for((var) = grub_script_function_list; \
 				      (var); (var) = (var)->next)
 
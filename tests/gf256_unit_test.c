@@ -0,0 +1,107 @@
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026 Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <grub/test.h>
+#include <grub/misc.h>
+#include <grub/gf256.h>
+
+#define MSG "gf256 test failed"
+
+#define MAX_SIZE 4200
+
+static grub_uint32_t seed = 1;
+
+static grub_uint8_t
+next_byte (void)
+{
+  seed = seed * 1103515245 + 12345;
+  return seed >> 16;
+}
+
+/* Shift-and-add multiplication, independent of the tables.  */
+static grub_uint8_t
+slow_mul (grub_uint8_t a, grub_uint8_t b)
+{
+  grub_uint8_t r = 0;
+
+  for (; b; b >>= 1)
+    {
+      if (b & 1)
+	r ^= a;
+      a = (a << 1) ^ ((a & 0x80) ? 0x1d : 0);
+    }
+  return r;
+}
+
+static void
+gf256_test (void)
+{
+  static grub_uint8_t src[MAX_SIZE], dst[MAX_SIZE], expected[MAX_SIZE];
+  unsigned a, b, i;
+  int n;
+
+  grub_gf256_init ();
+
+  for (a = 0; a < 256; a++)
+    for (b = 0; b < 256; b++)
+      grub_test_assert (grub_gf256_mul (a, b) == slow_mul (a, b),
+			"%s: %u * %u", MSG, a, b);
+
+  for (n = 0; n < 500; n++)
+    {
+      grub_size_t size = (n < 64) ? n : next_byte () * 16 + next_byte () % 16;
+      unsigned off = next_byte () % 16;
+      grub_uint8_t c = (n < 256) ? n : next_byte ();
+      int accumulate = n & 1;
+
+      if (off + size > MAX_SIZE)
+	size = MAX_SIZE - off;
+
+      for (i = 0; i < MAX_SIZE; i++)
+	{
+	  src[i] = next_byte ();
+	  dst[i] = expected[i] = next_byte ();
+	}
+      for (i = off; i < off + size; i++)
+	if (accumulate)
+	  expected[i] ^= slow_mul (src[i], c);
+	else
+	  expected[i] = slow_mul (src[i], c);
+
+      if (accumulate)
+	grub_gf256_mul_xor_region (dst + off, src + off, size, c);
+      else
+	grub_gf256_mul_region (dst + off, src + off, size, c);
+      grub_test_assert (memcmp (dst, expected, MAX_SIZE) == 0,
+			"%s: size %u, offset %u, constant %u", MSG,
+			(unsigned) size, off, c);
+
+      /* In place.  */
+      grub_memcpy (dst, src, MAX_SIZE);
+      grub_gf256_mul_region (dst + off, dst + off, size, c);
+      for (i = off; i < off + size; i++)
+	if (dst[i] != slow_mul (src[i], c))
+	  break;
+      grub_test_assert (i == off + size, "%s: in place, size %u", MSG,
+			(unsigned) size);
+    }
+}
+
+GRUB_UNIT_TEST ("gf256_unit_test", gf256_test);
@@ -40,6 +40,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 #include "progname.h"
 #include "argp.h"
@@ -53,6 +54,120 @@ static char **fuse_args = NULL;
 static int fuse_argc = 0;
 static int num_disks = 0;
 static int mount_crypt = 0;
+static int multithreaded = 0;
+
+/* GRUB itself isn't reentrant (grub_errno, the heap, the disk cache and the
+   file system drivers are all global), so with several FUSE threads every
+   call into it is serialized.  Only stat cache hits run in parallel.  */
+static pthread_mutex_t grub_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define STAT_CACHE_BUCKETS 4096
+#define STAT_CACHE_MAX_ENTRIES 262144
+
+/* Attributes of files already seen, filled by readdir and getattr so that
+   stat-ing the entries of a listed directory doesn't rescan it every time.
+   The mount is read-only, so entries never go stale.  Allocated with the
+   host allocator as it's used outside grub_lock.  */
+struct stat_cache_entry
+{
+  struct stat_cache_entry *next;
+  struct stat st;
+  char path[];
+};
+
+static struct stat_cache_entry *stat_cache[STAT_CACHE_BUCKETS];
+static unsigned stat_cache_entries;
+static pthread_rwlock_t stat_cache_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static unsigned
+stat_cache_hash (const char *path, size_t len)
+{
+  unsigned h = 2166136261U;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    h = (h ^ (unsigned char) path[i]) * 16777619U;
+  return h % STAT_CACHE_BUCKETS;
+}
+
+/* Strip trailing slashes so that all spellings of a path share an entry.  */
+static size_t
+stat_cache_key_len (const char *path)
+{
+  size_t len = strlen (path);
+
+  while (len > 1 && path[len - 1] == '/')
+    len--;
+  return len;
+}
+
+static int
+stat_cache_lookup (const char *path, struct stat *st)
+{
+  size_t len = stat_cache_key_len (path);
+  struct stat_cache_entry *e;
+  int found = 0;
+
+  pthread_rwlock_rdlock (&stat_cache_lock);
+  for (e = stat_cache[stat_cache_hash (path, len)]; e; e = e->next)
+    if (strncmp (e->path, path, len) == 0 && e->path[len] == 0)
+      {
+	*st = e->st;
+	found = 1;
+	break;
+      }
+  pthread_rwlock_unlock (&stat_cache_lock);
+  return found;
+}
+
+static void
+stat_cache_flush (void)
+{
+  struct stat_cache_entry *e, *next;
+  unsigned i;
+
+  for (i = 0; i < STAT_CACHE_BUCKETS; i++)
+    {
+      for (e = stat_cache[i]; e; e = next)
+	{
+	  next = e->next;
+	  free (e);
+	}
+      stat_cache[i] = NULL;
+    }
+  stat_cache_entries = 0;
+}
+
+static void
+stat_cache_insert (const char *path, const struct stat *st)
+{
+  size_t len = stat_cache_key_len (path);
+  struct stat_cache_entry *e;
+  unsigned h = stat_cache_hash (path, len);
+
+  pthread_rwlock_wrlock (&stat_cache_lock);
+  for (e = stat_cache[h]; e; e = e->next)
+    if (strncmp (e->path, path, len) == 0 && e->path[len] == 0)
+      break;
+  if (!e)
+    {
+      /* Start over rather than grow without bound on huge trees.  */
+      if (stat_cache_entries >= STAT_CACHE_MAX_ENTRIES)
+	stat_cache_flush ();
+      e = malloc (sizeof (*e) + len + 1);
+      if (e)
+	{
+	  memcpy (e->path, path, len);
+	  e->path[len] = 0;
+	  e->next = stat_cache[h];
+	  stat_cache[h] = e;
+	  stat_cache_entries++;
+	}
+    }
+  if (e)
+    e->st = *st;
+  pthread_rwlock_unlock (&stat_cache_lock);
+}
 
 static grub_err_t
 execute_command (const char *name, int n, char **args)
@@ -142,7 +257,7 @@ fuse_getattr_find_file (const char *cur_filename,
 }
 
 static int
-fuse_getattr (const char *path, struct stat *st)
+fuse_getattr_real (const char *path, struct stat *st)
 {
   struct fuse_getattr_ctx ctx;
   char *pathname, *path2;
@@ -224,58 +339,81 @@ fuse_getattr (const char *path, struct stat *st)
   return 0;
 }
 
+static int
+fuse_getattr (const char *path, struct stat *st)
+{
+  int ret;
+
+  if (stat_cache_lookup (path, st))
+    return 0;
+
+  pthread_mutex_lock (&grub_lock);
+  ret = fuse_getattr_real (path, st);
+  pthread_mutex_unlock (&grub_lock);
+  if (ret == 0)
+    stat_cache_insert (path, st);
+  return ret;
+}
+
 static int
 fuse_opendir (const char *path, struct fuse_file_info *fi) 
 {
   return 0;
 }
 
-/* FIXME */
-static grub_file_t files[65536];
-static int first_fd = 1;
-
+/* Every open gets its own GRUB file, kept in the FUSE handle, so that
+   concurrent readers don't share offsets.  */
 static int 
-fuse_open (const char *path, struct fuse_file_info *fi __attribute__ ((unused)))
+fuse_open (const char *path, struct fuse_file_info *fi)
 {
   grub_file_t file;
+  int ret = 0;
+
+  pthread_mutex_lock (&grub_lock);
   file = grub_file_open (path);
   if (! file)
-    return translate_error ();
-  files[first_fd++] = file;
-  fi->fh = first_fd;
-  files[first_fd++] = file;
+    ret = translate_error ();
+  else
+    fi->fh = (grub_addr_t) file;
   grub_errno = GRUB_ERR_NONE;
-  return 0;
+  pthread_mutex_unlock (&grub_lock);
+  return ret;
 } 
 
 static int 
 fuse_read (const char *path, char *buf, size_t sz, off_t off,
 	   struct fuse_file_info *fi)
 {
-  grub_file_t file = files[fi->fh];
+  grub_file_t file = (grub_file_t) (grub_addr_t) fi->fh;
   grub_ssize_t size;
+  int ret;
 
   if (off > file->size)
     return -EINVAL;
 
+  pthread_mutex_lock (&grub_lock);
   file->offset = off;
   
   size = grub_file_read (file, buf, sz);
   if (size < 0)
-    return translate_error ();
+    ret = translate_error ();
   else
     {
       grub_errno = GRUB_ERR_NONE;
-      return size;
+      ret = size;
     }
+  pthread_mutex_unlock (&grub_lock);
+  return ret;
 } 
 
 static int 
 fuse_release (const char *path, struct fuse_file_info *fi)
 {
-  grub_file_close (files[fi->fh]);
-  files[fi->fh] = NULL;
+  pthread_mutex_lock (&grub_lock);
+  grub_file_close ((grub_file_t) (grub_addr_t) fi->fh);
+  fi->fh = 0;
   grub_errno = GRUB_ERR_NONE;
+  pthread_mutex_unlock (&grub_lock);
   return 0;
 }
 
@@ -295,17 +433,22 @@ fuse_readdir_call_fill (const char *filename,
   struct fuse_readdir_ctx *ctx = data;
   struct stat st;
 
+  char *tmp;
+
   grub_memset (&st, 0, sizeof (st));
   st.st_mode = info->dir ? (0555 | S_IFDIR) : (0444 | S_IFREG);
+  tmp = xasprintf ("%s%s%s", ctx->path,
+		   ctx->path[0] && ctx->path[grub_strlen (ctx->path) - 1] == '/'
+		   ? "" : "/", filename);
   if (!info->dir)
     {
       grub_file_t file;
-      char *tmp;
-      tmp = xasprintf ("%s/%s", ctx->path, filename);
       file = grub_file_open (tmp);
-      free (tmp);
       if (! file)
-	return translate_error ();
+	{
+	  free (tmp);
+	  return translate_error ();
+	}
       st.st_size = file->size;
       grub_file_close (file);
     }
@@ -313,6 +456,10 @@ fuse_readdir_call_fill (const char *filename,
   st.st_blocks = (st.st_size + 511) >> 9;
   st.st_atime = st.st_mtime = st.st_ctime
     = info->mtimeset ? info->mtime : 0;
+  /* Case-insensitive file systems can be asked for other spellings; those
+     simply miss the cache.  */
+  stat_cache_insert (tmp, &st);
+  free (tmp);
   ctx->fill (ctx->buf, filename, &st, 0);
   return 0;
 }
@@ -335,9 +482,11 @@ fuse_readdir (const char *path, void *buf,
 	 && pathname[grub_strlen (pathname) - 1] == '/')
     pathname[grub_strlen (pathname) - 1] = 0;
 
+  pthread_mutex_lock (&grub_lock);
   (fs->dir) (dev, pathname, fuse_readdir_call_fill, &ctx);
-  free (pathname);
   grub_errno = GRUB_ERR_NONE;
+  pthread_mutex_unlock (&grub_lock);
+  free (pathname);
   return 0;
 }
 
@@ -438,6 +587,8 @@ static struct argp_option options[] = {
   {"zfs-key",      'K',
    /* TRANSLATORS: "prompt" is a keyword.  */
    N_("FILE|prompt"), 0, N_("Load zfs crypto key."),                 2},
+  {"threads",   'T', NULL, 0,
+   N_("Serve requests from several threads."), 2},
   {"verbose",   'v', NULL, 0, N_("print verbose messages."), 2},
   {0, 0, 0, 0, 0, 0}
 };
@@ -504,6 +655,10 @@ argp_parser (int key, char *arg, struct argp_state *state)
       debug_str = arg;
       return 0;
 
+    case 'T':
+      multithreaded = 1;
+      return 0;
+
     case 'v':
       verbosity++;
       return 0;
@@ -545,18 +700,21 @@ main (int argc, char *argv[])
 
   grub_util_init_nls ();
 
-  fuse_args = xrealloc (fuse_args, (fuse_argc + 2) * sizeof (fuse_args[0]));
+  fuse_args = xrealloc (fuse_args, (fuse_argc + 1) * sizeof (fuse_args[0]));
   fuse_args[fuse_argc] = xstrdup (argv[0]);
   fuse_argc++;
-  /* Run single-threaded.  */
-  fuse_args[fuse_argc] = xstrdup ("-s");
-  fuse_argc++;
 
   argp_parse (&argp, argc, argv, 0, 0, 0);
   
   if (num_disks < 2)
     grub_util_error ("%s", _("need an image and mountpoint"));
-  fuse_args = xrealloc (fuse_args, (fuse_argc + 2) * sizeof (fuse_args[0]));
+  fuse_args = xrealloc (fuse_args, (fuse_argc + 3) * sizeof (fuse_args[0]));
+  if (!multithreaded)
+    {
+      /* Run single-threaded.  */
+      fuse_args[fuse_argc] = xstrdup ("-s");
+      fuse_argc++;
+    }
   fuse_args[fuse_argc] = images[num_disks - 1];
   fuse_argc++;
   num_disks--;